@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Lock-free ring of mono samples between exactly one producer (the emulation thread) and one
+/// consumer (the audio device callback).
+///
+/// Neither side ever blocks: write() drops what doesn't fit and read() pads with silence. Both
+/// count the times that happened, and fill() lets the producer steer its rate towards keeping
+/// the ring half full, see System::queue_audio.
+class AudioRing {
+public:
+    /// capacity is rounded up to a power of two
+    explicit AudioRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        samples.resize(size);
+        mask = size - 1;
+    }
+
+    AudioRing(const AudioRing &)            = delete;
+    AudioRing &operator=(const AudioRing &) = delete;
+
+    /// producer side, returns the number of samples written. the rest is dropped
+    inline size_t write(const int16_t *in, size_t count) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_acquire);
+
+        size_t n = std::min(count, samples.size() - (t - h));
+        for (size_t i = 0; i < n; i++) {
+            samples[(t + i) & mask] = in[i];
+        }
+        tail.store(t + n, std::memory_order_release);
+
+        if (n < count) {
+            overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+    /// consumer side, fills out completely and returns the number of real samples in it. running
+    /// dry counts as an underrun once, not again for every read until samples arrive
+    inline size_t read(int16_t *out, size_t count) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t t = tail.load(std::memory_order_acquire);
+
+        size_t n = std::min(count, t - h);
+        for (size_t i = 0; i < n; i++) {
+            out[i] = samples[(h + i) & mask];
+        }
+        head.store(h + n, std::memory_order_release);
+
+        std::fill(out + n, out + count, (int16_t) 0);
+        if (n < count) {
+            if (!starved) {
+                underruns.fetch_add(1, std::memory_order_relaxed);
+            }
+            starved = true;
+        } else {
+            starved = false;
+        }
+        return n;
+    }
+
+    /// share of the capacity holding samples, 0 to 1. exact on either side's own thread, a
+    /// moment out of date on the other
+    inline double fill() const {
+        size_t t = tail.load(std::memory_order_acquire);
+        size_t h = head.load(std::memory_order_acquire);
+        return t > h ? (double) (t - h) / samples.size() : 0.0;
+    }
+
+    inline size_t get_capacity() const {
+        return samples.size();
+    }
+
+    inline uint64_t get_underruns() const {
+        return underruns.load(std::memory_order_relaxed);
+    }
+
+    inline uint64_t get_overruns() const {
+        return overruns.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<int16_t> samples;
+    size_t mask = 0;
+
+    // as in SpscQueue, the producer owns tail and the consumer head
+    alignas(64) std::atomic<size_t> tail{0};
+    std::atomic<uint64_t> overruns{0}; // writes that dropped samples
+    alignas(64) std::atomic<size_t> head{0};
+    std::atomic<uint64_t> underruns{0}; // times the consumer ran dry
+    bool starved = false;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+#include "common/types.hpp"
+
+namespace nes {
+
+/// slicing by 8 tables for the reflected CRC-32 polynomial (the zlib / PNG one)
+static constexpr std::array<std::array<u32, 256>, 8> make_crc32_lookup() {
+    std::array<std::array<u32, 256>, 8> table = {};
+
+    for (u32 i = 0; i < 256; i++) {
+        u32 crc = i;
+        for (u32 bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+        }
+        table[0][i] = crc;
+    }
+    for (u32 i = 0; i < 256; i++) {
+        for (u32 slice = 1; slice < 8; slice++) {
+            table[slice][i] = (table[slice - 1][i] >> 8) ^ table[0][table[slice - 1][i] & 0xFF];
+        }
+    }
+
+    return table;
+}
+
+static constexpr std::array<std::array<u32, 256>, 8> CRC32_LOOKUP = make_crc32_lookup();
+
+/// CRC-32 of the given bytes. pass a previous result as crc to continue a running checksum
+inline u32 crc32(const u8 *data, size_t size, u32 crc = 0) {
+    crc = ~crc;
+
+    // 8 bytes per step, the tables fold in one byte each
+    for (; size >= 8; size -= 8, data += 8) {
+        u32 lo, hi;
+        std::memcpy(&lo, data, 4);
+        std::memcpy(&hi, data + 4, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        lo = __builtin_bswap32(lo);
+        hi = __builtin_bswap32(hi);
+#endif
+        lo ^= crc;
+        crc = CRC32_LOOKUP[7][lo & 0xFF] ^ CRC32_LOOKUP[6][(lo >> 8) & 0xFF] ^
+              CRC32_LOOKUP[5][(lo >> 16) & 0xFF] ^ CRC32_LOOKUP[4][lo >> 24] ^
+              CRC32_LOOKUP[3][hi & 0xFF] ^ CRC32_LOOKUP[2][(hi >> 8) & 0xFF] ^
+              CRC32_LOOKUP[1][(hi >> 16) & 0xFF] ^ CRC32_LOOKUP[0][hi >> 24];
+    }
+
+    for (; size > 0; size--, data++) {
+        crc = (crc >> 8) ^ CRC32_LOOKUP[0][(crc ^ *data) & 0xFF];
+    }
+
+    return ~crc;
+}
+
+} // namespace nes
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <fmt/core.h>
+
+#include "common/types.hpp"
+
+namespace nes {
+
+/// Severity of a log message emitted by the emulation core
+enum LogLevel {
+    log_INFO,
+    log_WARNING,
+    log_ERROR,
+};
+
+/// Write a log message to stderr. The emulation core logs through this instead of the raylib
+/// TraceLog, so that it can be used without a window or a GL context.
+template <typename... Args>
+void log_message(LogLevel level, fmt::format_string<Args...> format, Args &&...args) {
+    static constexpr const char *LEVEL_NAMES[] = {"INFO", "WARNING", "ERROR"};
+
+    fmt::print(stderr, "{}: ", LEVEL_NAMES[level]);
+    fmt::print(stderr, format, std::forward<Args>(args)...);
+    fmt::print(stderr, "\n");
+}
+
+/// Rate limited warnings, for diagnostics on emulation hot paths (e.g. a buggy rom hammering
+/// unmapped addresses). They are off by default, in which case a warning costs a single branch.
+/// When enabled, messages are formatted into a stack buffer without allocating, and at most
+/// MAX_PER_SECOND are printed each second. The rest are only counted and summarized, when the
+/// next window starts or at the latest when the warnings are disabled or the program exits.
+struct HotPathWarnings {
+    static constexpr u32 MAX_PER_SECOND = 10;
+
+    static inline std::atomic<bool> enabled    = false;
+    static inline std::atomic<u32> printed     = 0; // in the current window
+    static inline std::atomic<u32> suppressed  = 0; // in the current window
+    static inline std::atomic<u64> windowStart = 0; // steady clock, in seconds
+
+    /// print a formatted message, or count it if the current window is used up
+    static void emit(const char *message, size_t length) {
+        auto now   = std::chrono::steady_clock::now().time_since_epoch();
+        u64 second = (u64) std::chrono::duration_cast<std::chrono::seconds>(now).count();
+
+        if (windowStart.exchange(second, std::memory_order_relaxed) != second) {
+            flush();
+            printed.store(0, std::memory_order_relaxed);
+        }
+
+        if (printed.fetch_add(1, std::memory_order_relaxed) < MAX_PER_SECOND) {
+            std::fprintf(stderr, "WARNING: %.*s\n", (int) length, message);
+        } else {
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /// print the summary of the warnings suppressed so far, if there are any
+    static void flush() {
+        u32 dropped = suppressed.exchange(0, std::memory_order_relaxed);
+        if (dropped != 0) {
+            std::fprintf(stderr, "WARNING: %u similar warnings suppressed\n", dropped);
+        }
+    }
+};
+
+/// enable or disable the hot path warnings, see HotPathWarnings
+inline void set_hot_path_warnings(bool enabled) {
+    HotPathWarnings::enabled.store(enabled, std::memory_order_relaxed);
+    if (!enabled) {
+        HotPathWarnings::flush();
+        return;
+    }
+
+    // a burst at the end of the run is never followed by the warning that would summarize it
+    static const bool flushAtExit = std::atexit(HotPathWarnings::flush) == 0;
+    (void) flushAtExit;
+}
+
+/// Log a warning from an emulation hot path, see HotPathWarnings
+template <typename... Args>
+inline void log_hot_path_warning(fmt::format_string<Args...> format, Args &&...args) {
+    if (!HotPathWarnings::enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    char buffer[256];
+    auto result = fmt::format_to_n(buffer, sizeof(buffer), format, std::forward<Args>(args)...);
+    HotPathWarnings::emit(buffer, std::min(result.size, sizeof(buffer)));
+}
+
+} // namespace nes
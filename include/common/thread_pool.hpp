@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/types.hpp"
+
+/// Fixed size pool of worker threads running parallel for loops with work stealing.
+///
+/// parallel_for() splits the index range evenly between the workers (the calling thread is one
+/// of them). Each worker takes indices one at a time from the front of its own range, and once
+/// that is empty steals the back half of the biggest range left. Ranges are packed into a single
+/// atomic word, so taking and stealing are both one compare and swap and never lock. Workers
+/// sleep on a condition variable between loops.
+class ThreadPool {
+public:
+    /// callback for one index of a parallel_for()
+    using TaskFunction = void (*)(void *context, u32 index);
+
+    /// threads includes the calling thread, 0 picks one per hardware thread
+    explicit ThreadPool(u32 threads = 0) {
+        if (threads == 0) {
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        slots = std::make_unique<Slot[]>(threads);
+        slotCount = threads;
+
+        for (u32 i = 1; i < threads; i++) {
+            workers.emplace_back(&ThreadPool::worker_loop, this, i);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &)            = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    inline u32 get_thread_count() const {
+        return slotCount;
+    }
+
+    /// call task(context, i) for every i in [0, count) and return once all calls have finished.
+    /// must not be called from inside a task
+    void parallel_for(u32 count, TaskFunction function, void *taskContext) {
+        if (count == 0) {
+            return;
+        }
+
+        for (u32 i = 0; i < slotCount; i++) {
+            u32 begin = (u32) ((u64) count * i / slotCount);
+            u32 end   = (u32) ((u64) count * (i + 1) / slotCount);
+            slots[i].range.store(pack(begin, end), std::memory_order_relaxed);
+        }
+        finished.store(0, std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task    = function;
+            context = taskContext;
+            generation++;
+        }
+        wake.notify_all();
+
+        run_tasks(0);
+
+        // a worker only stops once there is nothing left to take or steal, so when every worker
+        // has stopped all tasks are done. waiting for all of them also means none can still be
+        // looking at the slots when the next loop sets them up
+        while (finished.load(std::memory_order_acquire) != workers.size()) {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<u64> range{0}; // begin in the low half, end in the high half
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    u32 slotCount = 0;
+
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    u64 generation = 0;
+    bool quit      = false;
+
+    TaskFunction task = nullptr;
+    void *context     = nullptr;
+
+    alignas(64) std::atomic<u32> finished{0}; // workers done with the current loop
+
+    static inline u64 pack(u32 begin, u32 end) {
+        return ((u64) end << 32) | begin;
+    }
+
+    static inline u32 range_begin(u64 range) {
+        return (u32) range;
+    }
+
+    static inline u32 range_end(u64 range) {
+        return (u32) (range >> 32);
+    }
+
+    /// take the next index from the front of the given slot
+    bool take(u32 slot, u32 &index) {
+        u64 range = slots[slot].range.load(std::memory_order_acquire);
+        while (range_begin(range) < range_end(range)) {
+            u64 next = pack(range_begin(range) + 1, range_end(range));
+            if (slots[slot].range.compare_exchange_weak(range, next, std::memory_order_acq_rel)) {
+                index = range_begin(range);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// move the back half of the fullest other slot into the given (empty) slot
+    bool steal(u32 thief) {
+        for (;;) {
+            u32 victim = thief;
+            u64 range  = 0;
+            u32 most   = 0;
+            for (u32 i = 0; i < slotCount; i++) {
+                u64 r   = slots[i].range.load(std::memory_order_acquire);
+                u32 len = range_end(r) > range_begin(r) ? range_end(r) - range_begin(r) : 0;
+                if (i != thief && len > most) {
+                    victim = i;
+                    range  = r;
+                    most   = len;
+                }
+            }
+            if (most == 0) {
+                return false;
+            }
+
+            u32 split = range_end(range) - (most + 1) / 2;
+            if (slots[victim].range.compare_exchange_strong(
+                    range, pack(range_begin(range), split), std::memory_order_acq_rel)) {
+                slots[thief].range.store(pack(split, range_end(range)), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+
+    void run_tasks(u32 slot) {
+        u32 index;
+        for (;;) {
+            while (take(slot, index)) {
+                task(context, index);
+            }
+            if (!steal(slot)) {
+                return;
+            }
+        }
+    }
+
+    void worker_loop(u32 slot) {
+        u64 seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return quit || generation != seen; });
+                if (quit) {
+                    return;
+                }
+                seen = generation;
+            }
+            run_tasks(slot);
+            finished.fetch_add(1, std::memory_order_release);
+        }
+    }
+};
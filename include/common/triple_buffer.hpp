@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "common/types.hpp"
+
+/// Lock-free triple buffer, hands the newest value from one producer thread to one consumer
+/// thread.
+///
+/// The producer fills the back buffer and publishes it, which swaps it with the middle buffer.
+/// The consumer swaps the middle buffer with its front buffer when a new one was published.
+/// Neither side ever waits for the other, the producer simply overwrites values the consumer
+/// skipped.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+
+    TripleBuffer(const TripleBuffer &)            = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    /// producer side, the buffer to fill next
+    inline T &write_buffer() {
+        return buffers[back];
+    }
+
+    /// producer side, make the write buffer the newest value
+    inline void publish() {
+        u8 previous = middle.exchange(back | NEW_BIT, std::memory_order_acq_rel);
+        back        = previous & INDEX_MASK;
+    }
+
+    /// consumer side, switch to the newest value if one was published since the last call.
+    /// returns true if it did
+    inline bool update() {
+        if ((middle.load(std::memory_order_relaxed) & NEW_BIT) == 0) {
+            return false;
+        }
+        u8 previous = middle.exchange(front, std::memory_order_acq_rel);
+        front       = previous & INDEX_MASK;
+        return true;
+    }
+
+    /// consumer side, the newest value as of the last update()
+    inline const T &read_buffer() const {
+        return buffers[front];
+    }
+
+private:
+    static constexpr u8 INDEX_MASK = 0x03;
+    static constexpr u8 NEW_BIT    = 0x04;
+
+    std::array<T, 3> buffers = {};
+
+    // each side's index on its own cache line, the middle index is the only one shared
+    alignas(64) u8 back = 0;
+    alignas(64) std::atomic<u8> middle{1};
+    alignas(64) u8 front = 2;
+};
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "common/types.hpp"
+#include "nes/blip_buffer.hpp"
+#include "nes/scheduler.hpp"
+
+namespace nes {
+
+class Bus;
+
+/// The audio processing unit: two pulse channels, triangle, noise, DMC and the frame counter.
+///
+/// Like the ppu it catches up lazily. Channels are only run when a register is accessed, when
+/// the frame counter or a DMC sample fetch is due, or when a frame ends, and then run their
+/// timers in a tight loop over the whole stretch. Level changes go straight into a BlipBuffer at
+/// the output rate, so nothing is generated per cpu cycle. Channels are mixed with the usual
+/// linear approximation of the NES mixer, which lets every channel feed the buffer on its own.
+class Apu {
+public:
+    /// volume of all channels at full level, before the output high-pass
+    static constexpr float MASTER_VOLUME = 24000.0f;
+
+    struct Envelope {
+        bool start;
+        u8 divider;
+        u8 decay;
+    };
+
+    struct Pulse {
+        u8 duty;
+        bool halt;     // length counter halt, also envelope loop
+        bool constant; // constant volume instead of the envelope
+        u8 volume;     // constant volume or envelope period
+        bool sweepEnabled, sweepNegate, sweepReload;
+        u8 sweepPeriod, sweepShift, sweepDivider;
+        u16 period;
+        u8 length;
+        u8 step;
+        Envelope envelope;
+        u32 delay; // cpu cycles until the timer next clocks the sequencer
+        u8 output; // level last fed to the buffer
+    };
+
+    struct Triangle {
+        bool control; // length counter halt, also linear counter control
+        u8 linearLoad;
+        u8 linear;
+        bool linearReload;
+        u16 period;
+        u8 length;
+        u8 step;
+        u32 delay;
+        u8 output;
+    };
+
+    struct Noise {
+        bool halt;
+        bool constant;
+        u8 volume;
+        bool mode; // short, 93 step sequence
+        u8 periodIndex;
+        u16 shift; // linear feedback shift register
+        u8 length;
+        Envelope envelope;
+        u32 delay;
+        u8 output;
+    };
+
+    struct Dmc {
+        bool irqEnabled, loop;
+        u8 rateIndex;
+        u16 sampleAddress, sampleLength;
+        u16 address;    // next byte to fetch
+        u16 remaining;  // bytes left to fetch
+        u8 buffer;      // sample buffer
+        bool bufferFull;
+        u8 shift;       // output shift register
+        u8 bitsLeft;    // bits left in the output cycle
+        bool silence;
+        u8 level;       // 7 bit output level
+        u32 delay;
+        u8 output;
+    };
+
+    /// all mutable apu state, see Core::save_state. the sample buffer is output and not included
+    struct State {
+        std::array<Pulse, 2> pulse;
+        Triangle triangle;
+        Noise noise;
+        Dmc dmc;
+        u8 enabled; // channel enable bits, as written to $4015
+        bool fiveStep, irqInhibit, frameIrq, dmcIrq;
+        u8 frameStep;
+        u64 sequenceStart; // cpu cycle the current frame counter sequence started
+        u64 cycle;         // cpu cycle the channels have caught up to
+        u64 frameStart;    // cpu cycle the current sample buffer frame started
+    };
+
+    Apu();
+
+    void save_state(State &state) const;
+    void load_state(const State &state);
+
+    /// register with the scheduler, reads DMC samples through the bus and interrupts the cpu
+    void attach(Cpu *cpu, Bus *bus, Scheduler *scheduler);
+
+    void reset();
+
+    /// cpu side register access, $4000-$4013, $4015 and $4017
+    void write_register(u16 address, u8 data);
+    u8 read_status();
+
+    /// run the channels up to the current cpu cycle and make the samples so far readable
+    void end_frame();
+
+    /// output rate in Hz, 0 stops generating samples altogether (the channels still run)
+    void set_sample_rate(u32 rate);
+
+    inline u32 get_sample_rate() const {
+        return sampleRate;
+    }
+
+    /// make slightly more (ratio > 1) or fewer samples per emulated second than the sample rate,
+    /// to follow the clock of the device playing them. takes effect from the current frame on
+    inline void set_rate_ratio(double ratio) {
+        blip.set_rate_ratio(ratio);
+        reserve_buffer_frame();
+    }
+
+    /// stop feeding the buffer, e.g. while running frames that will be rolled back with
+    /// load_state(). the channels keep running, so only unmute after such a rollback
+    inline void set_muted(bool mute) {
+        muted = mute;
+    }
+
+    inline size_t samples_available() const {
+        return blip.samples_available();
+    }
+
+    /// read up to count mono samples, returns the number read
+    inline size_t read_samples(int16_t *out, size_t count) {
+        return blip.read_samples(out, count);
+    }
+
+public:
+    u64 droppedSamples = 0; // samples dropped because nobody read them in time
+
+private:
+    Cpu *cpu             = nullptr;
+    Bus *bus             = nullptr;
+    Scheduler *scheduler = nullptr;
+
+    std::array<Pulse, 2> pulse = {};
+    Triangle triangle          = {};
+    Noise noise                = {};
+    Dmc dmc                    = {};
+
+    // frame counter and status
+
+    u8 enabled      = 0;
+    bool fiveStep   = false;
+    bool irqInhibit = false;
+    bool frameIrq   = false;
+    bool dmcIrq     = false;
+    u8 frameStep    = 0;
+
+    u64 sequenceStart = 0;
+    u64 cycle         = 0;
+    u64 frameStart    = 0;
+
+    // output
+
+    BlipBuffer blip;
+    u32 sampleRate = 0;
+    bool muted     = false;
+
+    /// buffer the channels feed right now, nullptr while there is no output
+    inline BlipBuffer *sink() {
+        return sampleRate != 0 && !muted ? &blip : nullptr;
+    }
+
+    /// catch the channels up to the given cpu cycle
+    void run_until(u64 target);
+
+    void run_channels(u64 target);
+
+    void end_buffer_frame(u64 end);
+
+    /// drop unread samples until the frame being written fits in the buffer
+    void reserve_buffer_frame();
+
+    void run_pulse(Pulse &p, bool ones, u32 start, u32 end);
+    void run_triangle(u32 start, u32 end);
+    void run_noise(u32 start, u32 end);
+    void run_dmc(u32 start, u32 end);
+
+    void fetch_dmc_sample();
+
+    void clock_quarter_frame();
+    void clock_half_frame();
+
+    void update_irq();
+
+    void restart_sequence(u64 start);
+
+    void schedule_frame_step();
+
+    void schedule_dmc_fetch();
+
+    static void on_frame_counter(void *context, u64 timestamp);
+    static void on_dmc_fetch(void *context, u64 timestamp);
+};
+
+} // namespace nes
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common/types.hpp"
+
+namespace nes {
+
+/// Band-limited step synthesis, in the style of blargg's blip_buf.
+///
+/// Sound sources report the clock time and size of each change of their output level, and the
+/// buffer adds a band-limited impulse (a windowed sinc, picked from PHASES sub-sample offsets)
+/// for each one at the output sample rate. Reading integrates the impulses back into steps.
+/// There is never a stream at the source clock rate to filter and decimate, so the cost is per
+/// level change and per output sample.
+///
+/// Times are in source clocks relative to the start of the current frame, end_frame() moves
+/// the frame on and makes the samples before it readable.
+class BlipBuffer {
+public:
+    static constexpr u32 PHASE_BITS = 5;
+    static constexpr u32 PHASES     = 1 << PHASE_BITS;
+    static constexpr u32 TAPS       = 16; // impulse width in output samples
+
+    /// capacity in output samples
+    explicit BlipBuffer(size_t capacity = 0);
+
+    /// set the clock rate of the sources and the output sample rate. clears the buffer
+    void set_rates(double clockRate, double sampleRate);
+
+    /// scale the output rate by ratio (close to 1), keeping the buffered samples. for rate
+    /// control against the audio device clock, call between frames
+    inline void set_rate_ratio(double ratio) {
+        factor = (u64) ((double) baseFactor * ratio + 0.5);
+    }
+
+    /// forget all samples, including ones not yet readable
+    void clear();
+
+    /// add a level change of delta at the given clock time in the current frame
+    inline void add_delta(u32 time, float delta) {
+        u64 fixed          = offset + time * factor;
+        float *out         = &samples[fixed >> FRAC_BITS];
+        const auto &kernel = KERNELS[(fixed >> (FRAC_BITS - PHASE_BITS)) & (PHASES - 1)];
+        for (u32 i = 0; i < TAPS; i++) {
+            out[i] += kernel[i] * delta;
+        }
+    }
+
+    /// end the current frame after the given number of clocks, its samples become readable
+    void end_frame(u32 duration);
+
+    /// number of output samples a frame of the given length would add, at most
+    inline size_t samples_for(u32 duration) const {
+        return (size_t) (((offset & FRAC_MASK) + duration * factor) >> FRAC_BITS) + 1;
+    }
+
+    inline size_t samples_available() const {
+        return (size_t) (offset >> FRAC_BITS);
+    }
+
+    inline size_t get_capacity() const {
+        return capacity;
+    }
+
+    /// read up to count samples, returns the number read
+    size_t read_samples(int16_t *out, size_t count);
+
+    /// drop up to count of the oldest readable samples
+    void remove_samples(size_t count);
+
+private:
+    static constexpr u32 FRAC_BITS = 32;
+    static constexpr u64 FRAC_MASK = (1ULL << FRAC_BITS) - 1;
+
+    using Kernel = std::array<float, TAPS>;
+
+    /// one impulse per sub-sample offset, each summing to 1 so a step integrates to its size
+    static const std::array<Kernel, PHASES> KERNELS;
+
+    std::vector<float> samples; // impulses, capacity + TAPS so a frame's tails always fit
+    size_t capacity = 0;
+
+    u64 factor     = 0; // output samples per clock, FRAC_BITS fixed point
+    u64 baseFactor = 0; // factor at the nominal rates, before set_rate_ratio()
+    u64 offset     = 0; // start of the current frame, FRAC_BITS fixed point
+
+    float integrator = 0.0f; // running sum of the impulses read so far, i.e. the output level
+    float leak       = 0.0f; // share of the level lost per sample, a high-pass removing DC
+
+    /// move the first count samples out of the buffer
+    void shift_out(size_t count);
+};
+
+} // namespace nes
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+
+#include "common/types.hpp"
+#include "nes/bus.hpp"
+#include "nes/cpu.hpp"
+
+namespace nes {
+
+/// Cache of pre-decoded basic blocks for the Cpu.
+///
+/// A block is a run of instructions starting at some PC that ends at the first control flow
+/// instruction, at the end of the 256 byte page it starts in, or after MAX_BLOCK_LENGTH
+/// instructions. Opcodes, operand bytes and handlers are resolved once when the block is decoded.
+///
+/// Blocks are keyed by PC and the host page the PC is mapped to, so a bank switch (which just
+/// swaps the bus page table entries) makes stale blocks miss without any bookkeeping. Blocks
+/// decoded from writable memory write-protect their page on the bus; the first write to such a
+/// page drops every block decoded from it and unprotects it again.
+class BlockCache {
+public:
+    /// number of cached blocks, must be a power of two
+    static constexpr u32 BLOCK_COUNT = 1024;
+
+    /// maximum number of instructions in a single block
+    static constexpr u32 MAX_BLOCK_LENGTH = 8;
+
+    BlockCache() = default;
+
+    BlockCache(const BlockCache &)            = delete;
+    BlockCache &operator=(const BlockCache &) = delete;
+
+    void attach(Cpu *cpu, Bus *bus);
+
+    /// execute instructions until at least the given number of cycles have elapsed.
+    /// returns the number of cycles actually executed
+    u64 run(u64 cycles);
+
+    /// stop the running batch after the current instruction
+    inline void yield() {
+        target = 0;
+    }
+
+    /// drop every cached block, needed when the memory behind the bus is replaced
+    void invalidate_all();
+
+    /// drop the blocks decoded from writable memory, needed when that memory is changed without
+    /// going through the bus (e.g. loading a save state). blocks from ROM stay cached
+    void invalidate_writable();
+
+public:
+    u64 hits          = 0; // block lookups served from the cache
+    u64 misses        = 0; // block lookups that had to decode
+    u64 invalidations = 0; // writes that dropped blocks decoded from RAM
+
+private:
+    struct DecodedInstruction {
+        Cpu::DecodedHandler handler;
+        u16 operand;
+        u8 opcode; // only for Cpu::trace and Cpu::profiler
+    };
+
+    struct Block {
+        const u8 *page = nullptr; // host page the block was decoded from, nullptr if empty
+        u16 pc         = 0;
+        u8 count       = 0;
+        std::array<DecodedInstruction, MAX_BLOCK_LENGTH> instructions;
+    };
+
+    /// original mapping of a write-protected page
+    struct WriteTrap {
+        u8 *write = nullptr;
+        PageHandler handler;
+    };
+
+    Cpu *cpu = nullptr;
+    Bus *bus = nullptr;
+
+    std::array<Block, BLOCK_COUNT> blocks;
+    std::array<WriteTrap, Bus::PAGE_COUNT> traps;
+
+    /// cycle count the running batch stops at
+    u64 target = 0;
+
+    /// bumped whenever blocks are dropped, so a block that invalidates itself stops executing
+    u64 generation = 0;
+
+    /// the dispatch loop of run(). the instrumented one feeds Cpu::trace and Cpu::profiler
+    template <bool Instrumented>
+    void run_blocks();
+
+    /// find or decode the block starting at the cpu PC. returns nullptr if it can't be cached
+    const Block *lookup();
+
+    bool decode(Block &block, u16 pc, const u8 *page);
+
+    void protect_writes(u8 page);
+
+    void unprotect_writes(u8 *hostPage);
+
+    /// restore the original mapping of a single write-protected page
+    void remove_trap(u32 page);
+
+    static void write_trapped(void *context, u16 address, u8 data);
+};
+
+} // namespace nes
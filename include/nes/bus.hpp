@@ -2,32 +2,116 @@
 
 #include "common/types.hpp"
 #include "nes/cpu.hpp"
-#include "nes/rom.hpp"
 #include "nes/memory.hpp"
 
 #include <array>
 
 namespace nes {
 
+// Forward declaration of ppu class
+class Ppu;
+
+/// Read callback for a memory mapped register page
+using ReadHandler = u8 (*)(void *context, u16 address);
+
+/// Write callback for a memory mapped register page
+using WriteHandler = void (*)(void *context, u16 address, u8 data);
+
+/// Fallback for pages that are not backed by host memory (PPU / APU / IO registers etc.)
+struct PageHandler {
+    ReadHandler read   = nullptr;
+    WriteHandler write = nullptr;
+    void *context      = nullptr;
+};
+
 class Bus {
 public:
-    Bus() = default;
+    /// number of 256 byte pages in the cpu address space
+    static constexpr u32 PAGE_COUNT = 256;
 
-    u8 read_u8(u16 address);
+    Bus();
 
-    u16 read_u16(u16 address);
+    /// read one byte. pages backed by host memory are a single indexed load
+    inline u8 read_u8(u16 address) {
+        const u8 *page = readPages[address >> 8];
+        if (page != nullptr) {
+            return page[address & 0xFF];
+        }
+        const PageHandler &h = handlers[address >> 8];
+        return h.read(h.context, address);
+    }
 
-    void write_u8(u8 data, u16 address);
+    /// read one byte without side effects, for tracing and debuggers. pages that aren't backed
+    /// by host memory (registers) read as 0
+    inline u8 peek_u8(u16 address) const {
+        const u8 *page = readPages[address >> 8];
+        return page != nullptr ? page[address & 0xFF] : 0;
+    }
 
-    void write_u16(u16 data, u16 address);
+    inline u16 read_u16(u16 address) {
+        u16 lo = read_u8(address);
+        u16 hi = read_u8(address + 1);
+        return (hi << 8) | lo;
+    }
+
+    /// write one byte. pages backed by host memory are a single indexed store
+    inline void write_u8(u8 data, u16 address) {
+        u8 *page = writePages[address >> 8];
+        if (page != nullptr) {
+            page[address & 0xFF] = data;
+            return;
+        }
+        const PageHandler &h = handlers[address >> 8];
+        h.write(h.context, address, data);
+    }
+
+    inline void write_u16(u16 data, u16 address) {
+        write_u8(data & 0xFF, address);
+        write_u8((data >> 8) & 0xFF, address + 1);
+    }
 
     void attach_components(Cpu *cpu, Mem *m);
 
-    void attach_rom(Rom* rom);
+    /// route $4020-$FFFF through the given handler, the cartridge maps its own memory pages
+    void attach_cartridge(PageHandler handler);
+
+    void attach_ppu(Ppu *ppu);
+
+    /// route the APU / IO registers, $4000-$401F, through the given handler
+    void attach_io(PageHandler handler);
+
+    /// point a page at host memory. a nullptr routes that direction through the page handler
+    void map_page(u8 page, const u8 *read, u8 *write);
+
+    /// set the handler used by every page in [firstPage, lastPage] that is not backed by memory
+    void map_handler(u8 firstPage, u8 lastPage, PageHandler handler);
+
+    inline const u8 *get_read_page(u8 page) const {
+        return readPages[page];
+    }
+
+    inline u8 *get_write_page(u8 page) const {
+        return writePages[page];
+    }
+
+    inline const PageHandler &get_handler(u8 page) const {
+        return handlers[page];
+    }
 
 private:
     Mem *mem = nullptr;
-    Rom *rom = nullptr;
+
+    std::array<const u8 *, PAGE_COUNT> readPages  = {};
+    std::array<u8 *, PAGE_COUNT> writePages       = {};
+    std::array<PageHandler, PAGE_COUNT> handlers  = {};
+
+    // the $4000-$40FF page is shared, $4000-$401F are APU / IO registers and the rest of the page
+    // belongs to the cartridge. the page handler splits it between these two.
+    PageHandler ioHandler;
+    PageHandler cartHandler;
+
+    static u8 read_split_page(void *context, u16 address);
+    static void write_split_page(void *context, u16 address, u8 data);
 };
 
 } // namespace nes
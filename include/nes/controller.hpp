@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+
+#include "common/types.hpp"
+
+namespace nes {
+
+/// Standard controller buttons, in the order they are shifted out
+enum Button : u8 {
+    btn_A      = 0x01,
+    btn_B      = 0x02,
+    btn_SELECT = 0x04,
+    btn_START  = 0x08,
+    btn_UP     = 0x10,
+    btn_DOWN   = 0x20,
+    btn_LEFT   = 0x40,
+    btn_RIGHT  = 0x80,
+};
+
+/// The two standard controller ports, read through $4016 / $4017.
+///
+/// The host sets the held buttons with set_buttons() once per frame. Writing 1 then 0 to $4016
+/// latches them into a shift register per port, which the game reads out one bit at a time.
+class Controllers {
+public:
+    static constexpr u32 PORT_COUNT = 2;
+
+    /// all mutable controller state, see Core::save_state
+    struct State {
+        std::array<u8, PORT_COUNT> buttons;
+        std::array<u8, PORT_COUNT> shift;
+        bool strobe;
+    };
+
+    void save_state(State &state) const;
+    void load_state(const State &state);
+
+    /// Button bits held on the given port
+    inline void set_buttons(u32 port, u8 held) {
+        buttons[port] = held;
+    }
+
+    inline u8 get_buttons(u32 port) const {
+        return buttons[port];
+    }
+
+    /// $4016 / $4017 read
+    u8 read(u16 address);
+
+    /// $4016 write
+    void write_strobe(u8 data);
+
+private:
+    std::array<u8, PORT_COUNT> buttons = {};
+    std::array<u8, PORT_COUNT> shift   = {};
+    bool strobe                        = false;
+};
+
+} // namespace nes
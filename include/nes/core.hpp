@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+
+#include "common/types.hpp"
+#include "nes/apu.hpp"
+#include "nes/block_cache.hpp"
+#include "nes/bus.hpp"
+#include "nes/controller.hpp"
+#include "nes/cpu.hpp"
+#include "nes/mapper.hpp"
+#include "nes/memory.hpp"
+#include "nes/ppu.hpp"
+#include "nes/rom.hpp"
+#include "nes/rom_database.hpp"
+#include "nes/scheduler.hpp"
+
+namespace nes {
+
+/// NTSC CPU clock rate, in Hz
+static constexpr u64 CPU_CLOCK_RATE_HZ = 1789773;
+
+/// bumped whenever the layout of a save state changes
+static constexpr u32 SAVE_STATE_VERSION = 6;
+
+/// Start of a save state. It is followed by the Cpu, Ppu, Mem, Scheduler, Mapper, Controllers and
+/// Apu states and then PRG and CHR RAM, each copied as is. States are therefore only portable
+/// between builds with the same SAVE_STATE_VERSION, endianness and struct layout.
+struct SaveStateHeader {
+    std::array<char, 4> magic; // "NESS"
+    u32 version;
+    u32 size;     // whole state, including this header
+    u32 romCrc32; // rom the state was saved with
+};
+
+/// The emulation core, i.e. the CPU, bus, memory and cartridge wired together. It has no
+/// dependency on raylib or any window / GL context, so it can be driven headless.
+class Core {
+public:
+    Core();
+
+    Core(const Core &)            = delete;
+    Core &operator=(const Core &) = delete;
+
+    /// load a rom from the given path and reset the cpu. returns false if the rom is unusable.
+    /// headers are corrected from romDatabase, if set
+    bool load_rom(const std::string &filepath);
+
+    /// insert an already loaded rom image, which may be shared with other cores. only the
+    /// cartridge RAM is allocated per core
+    bool load_rom(std::shared_ptr<const Rom> image);
+
+    /// reset the cpu to a known state
+    void reset();
+
+    /// execute a single instruction, returns the number of cycles it took
+    u64 step();
+
+    /// run the cpu and scheduled events until at least the given number of cycles have elapsed.
+    /// returns the number of cycles actually executed
+    u64 run_cycles(u64 cycles);
+
+    /// size of a save state for the loaded rom, 0 if no rom is loaded
+    size_t get_save_state_size() const;
+
+    /// snapshot all emulation state into the buffer, which must hold get_save_state_size()
+    /// bytes. never allocates. returns false if the buffer is too small or no rom is loaded
+    bool save_state(u8 *buffer, size_t size) const;
+
+    /// restore a snapshot taken by save_state() for the same rom. never allocates. returns false,
+    /// leaving the current state alone, if the buffer doesn't hold a matching state
+    bool load_state(const u8 *buffer, size_t size);
+
+    /// save_state() / load_state() through a file
+    bool save_state_file(const std::string &filepath) const;
+    bool load_state_file(const std::string &filepath);
+
+    /// run until the ppu finishes the current frame (start of vblank), then make the frame's audio
+    /// readable. returns the number of cpu cycles executed
+    u64 run_frame();
+
+public:
+    Bus bus;
+    Cpu cpu;
+    Mem mem;
+    Ppu ppu;
+    Controllers controllers;
+    Apu apu;
+
+    std::shared_ptr<const Rom> rom;
+    std::unique_ptr<Mapper> mapper;
+
+    const RomDatabase *romDatabase = nullptr;
+
+    BlockCache blockCache;
+
+    Scheduler scheduler;
+
+private:
+    static void on_nmi(void *context, u64 timestamp);
+
+    static u8 read_io(void *context, u16 address);
+    static void write_io(void *context, u16 address, u8 data);
+
+    /// $4014, copy a page of cpu memory to OAM and stall the cpu for the transfer
+    void oam_dma(u8 page);
+};
+
+} // namespace nes
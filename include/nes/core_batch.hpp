@@ -0,0 +1,90 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/thread_pool.hpp"
+#include "common/types.hpp"
+#include "nes/core.hpp"
+
+namespace nes {
+
+/// Caller owned output buffers for CoreBatch::step(). Each is either nullptr (not wanted) or
+/// holds one contiguous slot per core, slot i belonging to core i.
+struct BatchObservations {
+    u8 *frames     = nullptr; // CoreBatch::FRAME_SIZE bytes per core, palette indices
+    u8 *ram        = nullptr; // CoreBatch::RAM_SIZE bytes per core
+    float *rewards = nullptr; // one per core
+};
+
+/// Computes the reward of one core after a step, e.g. from its RAM. called on worker threads
+using RewardFunction = float (*)(void *context, const Core &core, u32 index);
+
+/// K independent cores stepped in parallel, e.g. as a vectorized reinforcement learning
+/// environment.
+///
+/// The cores share nothing but the immutable rom image, so each step is one task per core on a
+/// work stealing ThreadPool. Frames are rendered straight into the caller's buffer (see
+/// Ppu::set_output), RAM is copied into it after the step.
+class CoreBatch {
+public:
+    static constexpr size_t FRAME_SIZE = Ppu::SCREEN_WIDTH * Ppu::SCREEN_HEIGHT;
+    static constexpr size_t RAM_SIZE   = Mem::MEM_SIZE_BYTES;
+
+    /// threads includes the calling thread, 0 picks one per hardware thread
+    explicit CoreBatch(u32 coreCount, u32 threads = 0);
+
+    CoreBatch(const CoreBatch &)            = delete;
+    CoreBatch &operator=(const CoreBatch &) = delete;
+
+    /// load the same rom into every core. returns false if any core rejects it
+    bool load_rom(const std::string &filepath);
+
+    /// reset every core
+    void reset();
+
+    /// number of frames each step runs with the same action, at least 1
+    inline void set_frame_skip(u32 frames) {
+        frameSkip = frames > 0 ? frames : 1;
+    }
+
+    inline void set_reward_function(RewardFunction function, void *context) {
+        reward        = function;
+        rewardContext = context;
+    }
+
+    /// run every core for the frame skip with actions[i] (Button bits) held on port 1 of core i,
+    /// and write the observations of core i into slot i of the buffers
+    void step(const u8 *actions, const BatchObservations &observations);
+
+    inline u32 get_core_count() const {
+        return (u32) cores.size();
+    }
+
+    inline Core &get_core(u32 index) {
+        return *cores[index];
+    }
+
+    inline u32 get_thread_count() const {
+        return pool.get_thread_count();
+    }
+
+private:
+    std::vector<std::unique_ptr<Core>> cores;
+
+    ThreadPool pool;
+
+    u32 frameSkip = 1;
+
+    RewardFunction reward = nullptr;
+    void *rewardContext   = nullptr;
+
+    // arguments of the running step, read by the tasks
+    const u8 *stepActions = nullptr;
+    BatchObservations stepObservations;
+
+    static void step_core(void *context, u32 index);
+};
+
+} // namespace nes
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <array>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "common/types.hpp"
@@ -11,6 +13,16 @@ namespace nes {
 
 // Forward declaration of bus class
 class Bus;
+class BlockCache;
+class TraceRing;
+class Profiler;
+
+/// Devices that can hold the IRQ line, bits of Cpu::irqLine
+enum IrqSource : u8 {
+    irq_MAPPER    = 1 << 0,
+    irq_APU_FRAME = 1 << 1,
+    irq_DMC       = 1 << 2,
+};
 
 /// The main Cpu abstraction for emulating the NES
 class Cpu {
@@ -30,9 +42,46 @@ public:
     /// non-maskable interrupt
     void nmi();
 
-    /// Emulate the clock cycle of the CPU
+    /// assert or release the (level triggered) IRQ line on behalf of a device
+    inline void set_irq_line(IrqSource source, bool asserted) {
+        irqLine = asserted ? (irqLine | source) : (irqLine & ~source);
+    }
+
+    /// take the interrupt if the IRQ line is held and interrupts are enabled. checked between
+    /// instruction blocks rather than after every instruction
+    inline void poll_irq() {
+        if (irqLine != 0 && (P & I) == 0) {
+            irq();
+        }
+    }
+
+    /// suspend the cpu for the given number of cycles while a DMA unit has the bus. they are
+    /// charged straight to cyclesExecuted, on top of the running instruction's cycles
+    inline void stall(u32 cycles) {
+        cyclesExecuted += cycles;
+    }
+
+    /// all mutable cpu state, see Core::save_state
+    struct State {
+        u8 A, X, Y, P, SP;
+        u16 PC;
+        Instruction instruction;
+        u8 cyclesRemaining;
+        u8 irqLine;
+        u64 cyclesExecuted;
+    };
+
+    void save_state(State &state) const;
+    void load_state(const State &state);
+
+    /// Emulate the clock cycle of the CPU. Executes one whole instruction through the opcode
+    /// dispatch table, where every opcode has its own compile time specialized handler.
     void clock();
 
+    /// Same as clock(), but decodes through the generic lookup + addressing mode / operation
+    /// switches. Kept as the reference implementation for benchmarks and differential testing.
+    void clock_reference();
+
 public:
     u8  A  = 0; // Accumulator Register, A
     u8  X  = 0; // Index Register, X
@@ -49,6 +98,12 @@ public:
 
     u64 cyclesExecuted = 0; // total number of cycles simulated
 
+    u8 irqLine = 0; // IrqSource bits of the devices currently holding the IRQ line
+
+    TraceRing *trace = nullptr; // records every instruction while set, see TraceRing
+
+    Profiler *profiler = nullptr; // counts every instruction while set, see Profiler
+
 private:
     /// Index of each status flag in the status register, P
     enum StatusFlag {
@@ -75,6 +130,56 @@ private:
     /// set the zero and negative bits in the status register based on the value of num
     void set_ZN_status(u8 num);
 
+    /// A + M + C into A with all flags, shared by ADC, SBC (with M inverted), RRA and ISC
+    void add_with_carry(u8 M);
+
+    /// set the flags of comparing R with M, as CMP / CPX / CPY / DCP / AXS do
+    void compare(u8 R, u8 M);
+
+private:
+    friend class BlockCache;
+
+    /// handler for a single opcode, see DISPATCH_TABLE
+    using OpcodeHandler = void (*)(Cpu &cpu);
+
+    /// handler for a single opcode whose operand bytes have already been decoded, see BlockCache
+    using DecodedHandler = void (*)(Cpu &cpu, u16 operand);
+
+    /// one handler per opcode, indexed by the opcode byte
+    static const std::array<OpcodeHandler, 256> DISPATCH_TABLE;
+
+    /// one handler per opcode, for pre-decoded instructions
+    static const std::array<DecodedHandler, 256> DECODED_DISPATCH_TABLE;
+
+    template <std::size_t... Opcodes>
+    static constexpr std::array<OpcodeHandler, 256> make_dispatch_table(
+        std::index_sequence<Opcodes...>);
+
+    template <std::size_t... Opcodes>
+    static constexpr std::array<DecodedHandler, 256> make_decoded_dispatch_table(
+        std::index_sequence<Opcodes...>);
+
+    /// fetch the operands of and execute a single opcode, all lookups are resolved at compile time
+    template <u8 opcode>
+    static void run_opcode(Cpu &cpu);
+
+    /// execute a single opcode with operand bytes supplied by the caller
+    template <u8 opcode>
+    static void run_decoded(Cpu &cpu, u16 operand);
+
+    /// resolve the operand address and execute the opcode, PC must already point past it
+    template <u8 opcode>
+    void complete_opcode(u16 operand);
+
+    /// turn the raw operand bytes into an address for the given addressing mode. if pagePenalty is
+    /// set, an extra cycle is added when indexing crosses a page boundary
+    template <AddressingMode mode, bool pagePenalty>
+    u16 resolve_address(u16 operand);
+
+    /// execute the given operation on an already resolved operand address
+    template <OperationType op, AddressingMode mode>
+    void execute(u16 addr);
+
 private:
     /// fetch the operand address for the instruction
     u16 get_operand_address();
@@ -88,7 +193,7 @@ private:
 public:
     std::vector<std::string> registers_to_strings() const;
 
-    std::string get_executing_instruction();
+    std::string get_executing_instruction() const;
 };
 
 } // namespace nes
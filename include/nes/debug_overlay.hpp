@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <utility>
+#include <fmt/format.h>
+
+#include "common/types.hpp"
+#include "nes/cpu.hpp"
+
+namespace nes {
+
+/// A line of overlay text, formatted in place into a fixed buffer
+class TextLine {
+public:
+    static constexpr size_t CAPACITY = 64;
+
+    /// format into the buffer, truncating at CAPACITY - 1 characters. never allocates
+    template <typename... Args>
+    void format(fmt::format_string<Args...> format, Args &&...args) {
+        auto result =
+            fmt::format_to_n(text.data(), CAPACITY - 1, format, std::forward<Args>(args)...);
+        *result.out = '\0';
+    }
+
+    inline const char *c_str() const {
+        return text.data();
+    }
+
+private:
+    std::array<char, CAPACITY> text = {};
+};
+
+/// Text of the debug overlay panels.
+///
+/// The panels keep a copy of the values they were last formatted from and only re-format when
+/// those change, so an update is usually a handful of compares and never allocates.
+class DebugOverlay {
+public:
+    static constexpr u32 REGISTER_LINES = 6;
+
+    /// what the status line shows
+    struct Status {
+        bool running;
+        bool fastForward;
+        bool autoRunAhead;
+        u32 runAheadFrames;
+        double frameCost; // seconds
+        double audioFill; // share of the audio ring holding samples
+        u64 audioUnderruns;
+        u64 audioOverruns;
+    };
+
+    /// re-format the panels whose values changed
+    void update(const Cpu &cpu, const Status &status);
+
+    inline const std::array<TextLine, REGISTER_LINES> &get_registers() const {
+        return registers;
+    }
+
+    inline const TextLine &get_instruction() const {
+        return instruction;
+    }
+
+    inline const TextLine &get_status() const {
+        return statusLine;
+    }
+
+    inline const TextLine &get_audio() const {
+        return audioLine;
+    }
+
+private:
+    // registers panel
+    std::array<TextLine, REGISTER_LINES> registers;
+    std::array<u16, REGISTER_LINES> registerValues = {};
+
+    // executing instruction
+    TextLine instruction;
+    Instruction instructionValue = {};
+
+    // emulation status
+    TextLine statusLine;
+    Status statusValue = {};
+    u32 frameCostShown = 0; // in the 10 us steps the line shows, the raw cost changes every frame
+
+    // audio ring
+    TextLine audioLine;
+    u32 audioFillShown = 0; // in percent
+    u64 underrunsShown = 0;
+    u64 overrunsShown  = 0;
+
+    bool formatted = false; // nothing is formatted before the first update
+};
+
+} // namespace nes
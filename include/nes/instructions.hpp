@@ -62,6 +62,20 @@ enum OperationType {
     op_TXS, // transfer X to SP
     op_TYA, // transfer Y to A
 
+    // stable unofficial instructions
+    op_LAX, // load to A and X
+    op_SAX, // store A AND X to memory
+    op_DCP, // decrement memory, then compare with A
+    op_ISC, // increment memory, then subtract from A
+    op_SLO, // shift memory left, then OR with A
+    op_RLA, // rotate memory left, then AND with A
+    op_SRE, // shift memory right, then EOR with A
+    op_RRA, // rotate memory right, then add to A
+    op_ANC, // AND with A, then copy N to C
+    op_ALR, // AND with A, then shift A right
+    op_ARR, // AND with A, then rotate A right with C and V from bits 6 and 5
+    op_AXS, // X = (A AND X) - immediate, flags as CMP
+
     op_XXX, // unknown op
 };
 
@@ -87,58 +101,72 @@ struct Instruction {
     u16 address;
 };
 
-static const Instruction INSTRUCTION_LOOKUP[256] = {
+static constexpr Instruction INSTRUCTION_LOOKUP[256] = {
     // HI\LO    0x0              0x1              0x2              0x3              0x4              0x5              0x6              0x7              0x8              0x9              0xA              0xB              0xC              0xD              0xE              0xF
     //----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-    /* 0x0 */  {op_BRK,am_IMP}, {op_ORA,am_INX}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_ORA,am_ZP0}, {op_ASL,am_ZP0}, {op_XXX,am_IMP}, {op_PHP,am_IMP}, {op_ORA,am_IMM}, {op_ASL,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_ORA,am_ABS}, {op_ASL,am_ABS}, {op_XXX,am_IMP},
-    /* 0x1 */  {op_BPL,am_REL}, {op_ORA,am_INY}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_ORA,am_ZPX}, {op_ASL,am_ZPX}, {op_XXX,am_IMP}, {op_CLC,am_IMP}, {op_ORA,am_ABY}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_ORA,am_ABX}, {op_ASL,am_ABX}, {op_XXX,am_IMP},
-    /* 0x2 */  {op_JSR,am_ABS}, {op_AND,am_INX}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_BIT,am_ZP0}, {op_AND,am_ZP0}, {op_ROL,am_ZP0}, {op_XXX,am_IMP}, {op_PLP,am_IMP}, {op_AND,am_IMM}, {op_ROL,am_IMP}, {op_XXX,am_IMP}, {op_BIT,am_ABS}, {op_AND,am_ABS}, {op_ROL,am_ABS}, {op_XXX,am_IMP},
-    /* 0x3 */  {op_BMI,am_REL}, {op_AND,am_INY}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_AND,am_ZPX}, {op_ROL,am_ZPX}, {op_XXX,am_IMP}, {op_SEC,am_IMP}, {op_AND,am_ABY}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_AND,am_ABX}, {op_ROL,am_ABX}, {op_XXX,am_IMP},
-    /* 0x4 */  {op_RTI,am_IMP}, {op_EOR,am_INX}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_EOR,am_ZP0}, {op_LSR,am_ZP0}, {op_XXX,am_IMP}, {op_PHA,am_IMP}, {op_EOR,am_IMM}, {op_LSR,am_IMP}, {op_XXX,am_IMP}, {op_JMP,am_ABS}, {op_EOR,am_ABS}, {op_LSR,am_ABS}, {op_XXX,am_IMP},
-    /* 0x5 */  {op_BVC,am_REL}, {op_EOR,am_INY}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_EOR,am_ZPX}, {op_LSR,am_ZPX}, {op_XXX,am_IMP}, {op_CLI,am_IMP}, {op_EOR,am_ABY}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_EOR,am_ABX}, {op_LSR,am_ABX}, {op_XXX,am_IMP},
-    /* 0x6 */  {op_RTS,am_IMP}, {op_ADC,am_INX}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_ADC,am_ZP0}, {op_ROR,am_ZP0}, {op_XXX,am_IMP}, {op_PLA,am_IMP}, {op_ADC,am_IMM}, {op_ROR,am_IMP}, {op_XXX,am_IMP}, {op_JMP,am_IND}, {op_ADC,am_ABS}, {op_ROR,am_ABS}, {op_XXX,am_IMP},
-    /* 0x7 */  {op_BVS,am_REL}, {op_ADC,am_INY}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_ADC,am_ZPX}, {op_ROR,am_ZPX}, {op_XXX,am_IMP}, {op_SEI,am_IMP}, {op_ADC,am_ABY}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_ADC,am_ABX}, {op_ROR,am_ABX}, {op_XXX,am_IMP},
-    /* 0x8 */  {op_XXX,am_IMP}, {op_STA,am_INX}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_STY,am_ZP0}, {op_STA,am_ZP0}, {op_STX,am_ZP0}, {op_XXX,am_IMP}, {op_DEY,am_IMP}, {op_XXX,am_IMP}, {op_TXA,am_IMP}, {op_XXX,am_IMP}, {op_STY,am_ABS}, {op_STA,am_ABS}, {op_STX,am_ABS}, {op_XXX,am_IMP},
-    /* 0x9 */  {op_BCC,am_REL}, {op_STA,am_INY}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_STY,am_ZPX}, {op_STA,am_ZPX}, {op_STX,am_ZPY}, {op_XXX,am_IMP}, {op_TYA,am_IMP}, {op_STA,am_ABY}, {op_TXS,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_STA,am_ABX}, {op_XXX,am_IMP}, {op_XXX,am_IMP},
-    /* 0xA */  {op_LDY,am_IMM}, {op_LDA,am_INX}, {op_LDX,am_IMM}, {op_XXX,am_IMP}, {op_LDY,am_ZP0}, {op_LDA,am_ZP0}, {op_LDX,am_ZP0}, {op_XXX,am_IMP}, {op_TAY,am_IMP}, {op_LDA,am_IMM}, {op_TAX,am_IMP}, {op_XXX,am_IMP}, {op_LDY,am_ABS}, {op_LDA,am_ABS}, {op_LDX,am_ABS}, {op_XXX,am_IMP},
-    /* 0xB */  {op_BCS,am_REL}, {op_LDA,am_INY}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_LDY,am_ZPX}, {op_LDA,am_ZPX}, {op_LDX,am_ZPY}, {op_XXX,am_IMP}, {op_CLV,am_IMP}, {op_LDA,am_ABY}, {op_TSX,am_IMP}, {op_XXX,am_IMP}, {op_LDY,am_ABX}, {op_LDA,am_ABX}, {op_LDX,am_ABY}, {op_XXX,am_IMP},
-    /* 0xC */  {op_CPY,am_IMM}, {op_CMP,am_INX}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_CPY,am_ZP0}, {op_CMP,am_ZP0}, {op_DEC,am_ZP0}, {op_XXX,am_IMP}, {op_INY,am_IMP}, {op_CMP,am_IMM}, {op_DEX,am_IMP}, {op_XXX,am_IMP}, {op_CPY,am_ABS}, {op_CMP,am_ABS}, {op_DEC,am_ABS}, {op_XXX,am_IMP},
-    /* 0xD */  {op_BNE,am_REL}, {op_CMP,am_INY}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_CMP,am_ZPX}, {op_DEC,am_ZPX}, {op_XXX,am_IMP}, {op_CLD,am_IMP}, {op_CMP,am_ABY}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_CMP,am_ABX}, {op_DEC,am_ABX}, {op_XXX,am_IMP},
-    /* 0xE */  {op_CPX,am_IMM}, {op_SBC,am_INX}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_CPX,am_ZP0}, {op_SBC,am_ZP0}, {op_INC,am_ZP0}, {op_XXX,am_IMP}, {op_INX,am_IMP}, {op_SBC,am_IMM}, {op_NOP,am_IMP}, {op_XXX,am_IMP}, {op_CPX,am_ABS}, {op_SBC,am_ABS}, {op_INC,am_ABS}, {op_XXX,am_IMP},
-    /* 0xF */  {op_BEQ,am_REL}, {op_SBC,am_INY}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_SBC,am_ZPX}, {op_INC,am_ZPX}, {op_XXX,am_IMP}, {op_SED,am_IMP}, {op_SBC,am_ABY}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_SBC,am_ABX}, {op_INC,am_ABX}, {op_XXX,am_IMP},
+    /* 0x0 */  {op_BRK,am_IMP}, {op_ORA,am_INX}, {op_XXX,am_IMP}, {op_SLO,am_INX}, {op_NOP,am_ZP0}, {op_ORA,am_ZP0}, {op_ASL,am_ZP0}, {op_SLO,am_ZP0}, {op_PHP,am_IMP}, {op_ORA,am_IMM}, {op_ASL,am_IMP}, {op_ANC,am_IMM}, {op_NOP,am_ABS}, {op_ORA,am_ABS}, {op_ASL,am_ABS}, {op_SLO,am_ABS},
+    /* 0x1 */  {op_BPL,am_REL}, {op_ORA,am_INY}, {op_XXX,am_IMP}, {op_SLO,am_INY}, {op_NOP,am_ZPX}, {op_ORA,am_ZPX}, {op_ASL,am_ZPX}, {op_SLO,am_ZPX}, {op_CLC,am_IMP}, {op_ORA,am_ABY}, {op_NOP,am_IMP}, {op_SLO,am_ABY}, {op_NOP,am_ABX}, {op_ORA,am_ABX}, {op_ASL,am_ABX}, {op_SLO,am_ABX},
+    /* 0x2 */  {op_JSR,am_ABS}, {op_AND,am_INX}, {op_XXX,am_IMP}, {op_RLA,am_INX}, {op_BIT,am_ZP0}, {op_AND,am_ZP0}, {op_ROL,am_ZP0}, {op_RLA,am_ZP0}, {op_PLP,am_IMP}, {op_AND,am_IMM}, {op_ROL,am_IMP}, {op_ANC,am_IMM}, {op_BIT,am_ABS}, {op_AND,am_ABS}, {op_ROL,am_ABS}, {op_RLA,am_ABS},
+    /* 0x3 */  {op_BMI,am_REL}, {op_AND,am_INY}, {op_XXX,am_IMP}, {op_RLA,am_INY}, {op_NOP,am_ZPX}, {op_AND,am_ZPX}, {op_ROL,am_ZPX}, {op_RLA,am_ZPX}, {op_SEC,am_IMP}, {op_AND,am_ABY}, {op_NOP,am_IMP}, {op_RLA,am_ABY}, {op_NOP,am_ABX}, {op_AND,am_ABX}, {op_ROL,am_ABX}, {op_RLA,am_ABX},
+    /* 0x4 */  {op_RTI,am_IMP}, {op_EOR,am_INX}, {op_XXX,am_IMP}, {op_SRE,am_INX}, {op_NOP,am_ZP0}, {op_EOR,am_ZP0}, {op_LSR,am_ZP0}, {op_SRE,am_ZP0}, {op_PHA,am_IMP}, {op_EOR,am_IMM}, {op_LSR,am_IMP}, {op_ALR,am_IMM}, {op_JMP,am_ABS}, {op_EOR,am_ABS}, {op_LSR,am_ABS}, {op_SRE,am_ABS},
+    /* 0x5 */  {op_BVC,am_REL}, {op_EOR,am_INY}, {op_XXX,am_IMP}, {op_SRE,am_INY}, {op_NOP,am_ZPX}, {op_EOR,am_ZPX}, {op_LSR,am_ZPX}, {op_SRE,am_ZPX}, {op_CLI,am_IMP}, {op_EOR,am_ABY}, {op_NOP,am_IMP}, {op_SRE,am_ABY}, {op_NOP,am_ABX}, {op_EOR,am_ABX}, {op_LSR,am_ABX}, {op_SRE,am_ABX},
+    /* 0x6 */  {op_RTS,am_IMP}, {op_ADC,am_INX}, {op_XXX,am_IMP}, {op_RRA,am_INX}, {op_NOP,am_ZP0}, {op_ADC,am_ZP0}, {op_ROR,am_ZP0}, {op_RRA,am_ZP0}, {op_PLA,am_IMP}, {op_ADC,am_IMM}, {op_ROR,am_IMP}, {op_ARR,am_IMM}, {op_JMP,am_IND}, {op_ADC,am_ABS}, {op_ROR,am_ABS}, {op_RRA,am_ABS},
+    /* 0x7 */  {op_BVS,am_REL}, {op_ADC,am_INY}, {op_XXX,am_IMP}, {op_RRA,am_INY}, {op_NOP,am_ZPX}, {op_ADC,am_ZPX}, {op_ROR,am_ZPX}, {op_RRA,am_ZPX}, {op_SEI,am_IMP}, {op_ADC,am_ABY}, {op_NOP,am_IMP}, {op_RRA,am_ABY}, {op_NOP,am_ABX}, {op_ADC,am_ABX}, {op_ROR,am_ABX}, {op_RRA,am_ABX},
+    /* 0x8 */  {op_NOP,am_IMM}, {op_STA,am_INX}, {op_NOP,am_IMM}, {op_SAX,am_INX}, {op_STY,am_ZP0}, {op_STA,am_ZP0}, {op_STX,am_ZP0}, {op_SAX,am_ZP0}, {op_DEY,am_IMP}, {op_NOP,am_IMM}, {op_TXA,am_IMP}, {op_XXX,am_IMP}, {op_STY,am_ABS}, {op_STA,am_ABS}, {op_STX,am_ABS}, {op_SAX,am_ABS},
+    /* 0x9 */  {op_BCC,am_REL}, {op_STA,am_INY}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_STY,am_ZPX}, {op_STA,am_ZPX}, {op_STX,am_ZPY}, {op_SAX,am_ZPY}, {op_TYA,am_IMP}, {op_STA,am_ABY}, {op_TXS,am_IMP}, {op_XXX,am_IMP}, {op_XXX,am_IMP}, {op_STA,am_ABX}, {op_XXX,am_IMP}, {op_XXX,am_IMP},
+    /* 0xA */  {op_LDY,am_IMM}, {op_LDA,am_INX}, {op_LDX,am_IMM}, {op_LAX,am_INX}, {op_LDY,am_ZP0}, {op_LDA,am_ZP0}, {op_LDX,am_ZP0}, {op_LAX,am_ZP0}, {op_TAY,am_IMP}, {op_LDA,am_IMM}, {op_TAX,am_IMP}, {op_XXX,am_IMP}, {op_LDY,am_ABS}, {op_LDA,am_ABS}, {op_LDX,am_ABS}, {op_LAX,am_ABS},
+    /* 0xB */  {op_BCS,am_REL}, {op_LDA,am_INY}, {op_XXX,am_IMP}, {op_LAX,am_INY}, {op_LDY,am_ZPX}, {op_LDA,am_ZPX}, {op_LDX,am_ZPY}, {op_LAX,am_ZPY}, {op_CLV,am_IMP}, {op_LDA,am_ABY}, {op_TSX,am_IMP}, {op_XXX,am_IMP}, {op_LDY,am_ABX}, {op_LDA,am_ABX}, {op_LDX,am_ABY}, {op_LAX,am_ABY},
+    /* 0xC */  {op_CPY,am_IMM}, {op_CMP,am_INX}, {op_NOP,am_IMM}, {op_DCP,am_INX}, {op_CPY,am_ZP0}, {op_CMP,am_ZP0}, {op_DEC,am_ZP0}, {op_DCP,am_ZP0}, {op_INY,am_IMP}, {op_CMP,am_IMM}, {op_DEX,am_IMP}, {op_AXS,am_IMM}, {op_CPY,am_ABS}, {op_CMP,am_ABS}, {op_DEC,am_ABS}, {op_DCP,am_ABS},
+    /* 0xD */  {op_BNE,am_REL}, {op_CMP,am_INY}, {op_XXX,am_IMP}, {op_DCP,am_INY}, {op_NOP,am_ZPX}, {op_CMP,am_ZPX}, {op_DEC,am_ZPX}, {op_DCP,am_ZPX}, {op_CLD,am_IMP}, {op_CMP,am_ABY}, {op_NOP,am_IMP}, {op_DCP,am_ABY}, {op_NOP,am_ABX}, {op_CMP,am_ABX}, {op_DEC,am_ABX}, {op_DCP,am_ABX},
+    /* 0xE */  {op_CPX,am_IMM}, {op_SBC,am_INX}, {op_NOP,am_IMM}, {op_ISC,am_INX}, {op_CPX,am_ZP0}, {op_SBC,am_ZP0}, {op_INC,am_ZP0}, {op_ISC,am_ZP0}, {op_INX,am_IMP}, {op_SBC,am_IMM}, {op_NOP,am_IMP}, {op_SBC,am_IMM}, {op_CPX,am_ABS}, {op_SBC,am_ABS}, {op_INC,am_ABS}, {op_ISC,am_ABS},
+    /* 0xF */  {op_BEQ,am_REL}, {op_SBC,am_INY}, {op_XXX,am_IMP}, {op_ISC,am_INY}, {op_NOP,am_ZPX}, {op_SBC,am_ZPX}, {op_INC,am_ZPX}, {op_ISC,am_ZPX}, {op_SED,am_IMP}, {op_SBC,am_ABY}, {op_NOP,am_IMP}, {op_ISC,am_ABY}, {op_NOP,am_ABX}, {op_SBC,am_ABX}, {op_INC,am_ABX}, {op_ISC,am_ABX},
 };
 
-static const u64 CYCLE_COUNT_LOOKUP[256] = {
+/// base cycles per opcode. the unimplemented (op_XXX) ones take 2 like a NOP, never 0
+static constexpr u64 CYCLE_COUNT_LOOKUP[256] = {
     // HI\LO    0x0  0x1  0x2  0x3  0x4  0x5  0x6  0x7  0x8  0x9  0xA  0xB  0xC  0xD  0xE  0xF
     //-----------------------------------------------------------------------------------------
-    /* 0x0 */   7,   6,   0,   0,   0,   3,   5,   0,   3,   2,   2,   0,   0,   4,   6,   0,
-    /* 0x1 */   2,   5,   0,   0,   0,   4,   6,   0,   2,   4,   0,   0,   0,   4,   7,   0,
-    /* 0x2 */   6,   6,   0,   0,   3,   3,   5,   0,   4,   2,   2,   0,   4,   4,   6,   0,
-    /* 0x3 */   2,   5,   0,   0,   0,   4,   6,   0,   2,   4,   0,   0,   0,   4,   7,   0,
-    /* 0x4 */   6,   6,   0,   0,   0,   3,   5,   0,   3,   2,   2,   0,   3,   4,   6,   0,
-    /* 0x5 */   2,   5,   0,   0,   0,   4,   6,   0,   2,   4,   0,   0,   0,   4,   7,   0,
-    /* 0x6 */   6,   6,   0,   0,   0,   3,   5,   0,   4,   2,   2,   0,   5,   4,   6,   0,
-    /* 0x7 */   2,   5,   0,   0,   0,   4,   6,   0,   2,   4,   0,   0,   0,   4,   7,   0,
-    /* 0x8 */   0,   6,   0,   0,   3,   3,   3,   0,   2,   0,   2,   0,   4,   4,   4,   0,
-    /* 0x9 */   2,   6,   0,   0,   4,   4,   4,   0,   2,   5,   2,   0,   0,   5,   0,   0,
-    /* 0xA */   2,   6,   2,   0,   3,   3,   3,   0,   2,   2,   2,   0,   4,   4,   4,   0,
-    /* 0xB */   2,   5,   0,   0,   4,   4,   4,   0,   2,   4,   2,   0,   4,   4,   4,   0,
-    /* 0xC */   2,   6,   0,   0,   3,   3,   5,   0,   2,   2,   2,   0,   4,   4,   6,   0,
-    /* 0xD */   2,   5,   0,   0,   0,   4,   6,   0,   2,   4,   0,   0,   0,   4,   7,   0,
-    /* 0xE */   2,   6,   0,   0,   3,   3,   5,   0,   2,   2,   2,   2,   4,   4,   6,   0,
-    /* 0xF */   2,   5,   0,   0,   0,   4,   6,   0,   2,   4,   0,   0,   0,   4,   7,   0,
+    /* 0x0 */   7,   6,   2,   8,   3,   3,   5,   5,   3,   2,   2,   2,   4,   4,   6,   6,
+    /* 0x1 */   2,   5,   2,   8,   4,   4,   6,   6,   2,   4,   2,   7,   4,   4,   7,   7,
+    /* 0x2 */   6,   6,   2,   8,   3,   3,   5,   5,   4,   2,   2,   2,   4,   4,   6,   6,
+    /* 0x3 */   2,   5,   2,   8,   4,   4,   6,   6,   2,   4,   2,   7,   4,   4,   7,   7,
+    /* 0x4 */   6,   6,   2,   8,   3,   3,   5,   5,   3,   2,   2,   2,   3,   4,   6,   6,
+    /* 0x5 */   2,   5,   2,   8,   4,   4,   6,   6,   2,   4,   2,   7,   4,   4,   7,   7,
+    /* 0x6 */   6,   6,   2,   8,   3,   3,   5,   5,   4,   2,   2,   2,   5,   4,   6,   6,
+    /* 0x7 */   2,   5,   2,   8,   4,   4,   6,   6,   2,   4,   2,   7,   4,   4,   7,   7,
+    /* 0x8 */   2,   6,   2,   6,   3,   3,   3,   3,   2,   2,   2,   2,   4,   4,   4,   4,
+    /* 0x9 */   2,   6,   2,   2,   4,   4,   4,   4,   2,   5,   2,   2,   2,   5,   2,   2,
+    /* 0xA */   2,   6,   2,   6,   3,   3,   3,   3,   2,   2,   2,   2,   4,   4,   4,   4,
+    /* 0xB */   2,   5,   2,   5,   4,   4,   4,   4,   2,   4,   2,   2,   4,   4,   4,   4,
+    /* 0xC */   2,   6,   2,   8,   3,   3,   5,   5,   2,   2,   2,   2,   4,   4,   6,   6,
+    /* 0xD */   2,   5,   2,   8,   4,   4,   6,   6,   2,   4,   2,   7,   4,   4,   7,   7,
+    /* 0xE */   2,   6,   2,   8,   3,   3,   5,   5,   2,   2,   2,   2,   4,   4,   6,   6,
+    /* 0xF */   2,   5,   2,   8,   4,   4,   6,   6,   2,   4,   2,   7,   4,   4,   7,   7,
 };
 
-static constexpr const char *INSTRUCTION_NAME_LOOKUP[57] = {
+static constexpr const char *INSTRUCTION_NAME_LOOKUP[op_XXX + 1] = {
     "ADC", "AND", "ASL", "BCC", "BCS", "BEQ", "BIT", "BMI", "BNE", "BPL", "BRK", "BVC",
     "BVS", "CLC", "CLD", "CLI", "CLV", "CMP", "CPX", "CPY", "DEC", "DEX", "DEY", "EOR",
     "INC", "INX", "INY", "JMP", "JSR", "LDA", "LDX", "LDY", "LSR", "NOP", "ORA", "PHA",
     "PHP", "PLA", "PLP", "ROL", "ROR", "RTI", "RTS", "SBC", "SEC", "SED", "SEI", "STA",
-    "STX", "STY", "TAX", "TAY", "TSX", "TXA", "TXS", "TYA", "XXX",
+    "STX", "STY", "TAX", "TAY", "TSX", "TXA", "TXS", "TYA", "LAX", "SAX", "DCP", "ISC",
+    "SLO", "RLA", "SRE", "RRA", "ANC", "ALR", "ARR", "AXS", "XXX",
 };
 
 static constexpr const char *ADDRMODE_NAME_LOOKUP[] = {
     "ABS", "ABX", "ABY", "IMM", "IMP", "IND", "INX", "INY", "REL", "ZP0", "ZPX", "ZPY",
 };
 
+/// opcodes outside the documented instruction set, including the NOP and SBC #imm aliases
+static constexpr bool is_unofficial_opcode(u8 opcode) {
+    const Instruction &ins = INSTRUCTION_LOOKUP[opcode];
+    return (ins.op >= op_LAX && ins.op != op_XXX) || (ins.op == op_NOP && opcode != 0xEA) ||
+           opcode == 0xEB;
+}
+
+/// number of operand bytes following the opcode, per addressing mode
+static constexpr u8 OPERAND_LENGTH_LOOKUP[] = {
+    2, 2, 2, 1, 0, 2, 1, 1, 1, 1, 1, 1,
+};
+
 } // namespace nes
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "common/types.hpp"
+
+namespace nes {
+
+/// A read only view of a whole file, backed by a memory mapping where the platform supports it.
+///
+/// Mapped pages come straight from the OS page cache, so every process (and every instance in a
+/// process) that opens the same file shares the same physical memory, and nothing is read until
+/// it is touched. If the file can't be mapped it is read into a heap buffer instead.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /// map the given file, replacing any previous one. returns false if it can't be opened
+    bool open(const char *path);
+
+    void close();
+
+    inline const u8 *data() const {
+        return bytes;
+    }
+
+    inline size_t size() const {
+        return length;
+    }
+
+    /// false if the file contents were copied to the heap
+    inline bool is_mapped() const {
+        return mapping != nullptr;
+    }
+
+private:
+    const u8 *bytes = nullptr;
+    size_t length   = 0;
+
+    void *mapping = nullptr; // platform mapping, nullptr when using the fallback buffer
+    void *handle  = nullptr; // windows file mapping object
+
+    std::vector<u8> fallback;
+};
+
+} // namespace nes
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "common/types.hpp"
+#include "nes/bus.hpp"
+#include "nes/cpu.hpp"
+#include "nes/ppu.hpp"
+#include "nes/rom.hpp"
+#include "nes/scheduler.hpp"
+
+namespace nes {
+
+/// Cartridge mapper base.
+///
+/// A bank switch doesn't change how an address is decoded, it repoints a window of bus pages (PRG)
+/// or PPU pattern table pages (CHR) at a different part of the rom. Reads from the cartridge then
+/// stay a single indexed load on the bus fast path, and only writes to $8000-$FFFF reach the
+/// mapper. Cartridges with PRG RAM get it mapped at $6000-$7FFF, mirrored if it is smaller.
+class Mapper {
+public:
+    static constexpr u32 PRG_BANK_SIZE = 8 * 1024;
+    static constexpr u32 CHR_BANK_SIZE = 1024;
+
+    /// space for the mapper specific registers in State
+    static constexpr u32 REGISTERS_SIZE = 32;
+
+    /// ppu dot at which a scanline counter is clocked. with background patterns at $0000 and
+    /// sprite patterns at $1000 this is where PPU A12 rises on every rendered line
+    static constexpr u32 SCANLINE_COUNTER_DOT = 260;
+
+    /// all mutable mapper state, see Core::save_state. PRG and CHR RAM are saved separately
+    struct State {
+        std::array<u8, REGISTERS_SIZE> registers;
+    };
+
+    /// create the mapper the rom asks for, or nullptr if it is not supported
+    static std::unique_ptr<Mapper> create(const Rom *rom);
+
+    virtual ~Mapper() = default;
+
+    Mapper(const Mapper &)            = delete;
+    Mapper &operator=(const Mapper &) = delete;
+
+    /// take over the cartridge space of the bus and the ppu pattern tables, and map the power on
+    /// banks
+    void attach(Bus *bus, Ppu *ppu, Cpu *cpu, Scheduler *scheduler);
+
+    /// the cartridge's PRG RAM (Rom::get_prg_ram_size() bytes), or nullptr if it has none
+    inline u8 *get_prg_ram() {
+        return prgRam.empty() ? nullptr : prgRam.data();
+    }
+
+    inline const u8 *get_prg_ram() const {
+        return prgRam.empty() ? nullptr : prgRam.data();
+    }
+
+    /// the cartridge's CHR RAM (Rom::get_chr_size() bytes), or nullptr if it has CHR ROM
+    inline u8 *get_chr_ram() {
+        return chrRam.empty() ? nullptr : chrRam.data();
+    }
+
+    inline const u8 *get_chr_ram() const {
+        return chrRam.empty() ? nullptr : chrRam.data();
+    }
+
+    void save_state(State &state) const;
+    void load_state(const State &state);
+
+protected:
+    explicit Mapper(const Rom *rom);
+
+    /// set up the power on state, called once the mapper is attached
+    virtual void power_on() = 0;
+
+    /// cpu write to $8000-$FFFF
+    virtual void write_register(u16 address, u8 data) = 0;
+
+    /// once per rendered scanline (and the pre-render line) at SCANLINE_COUNTER_DOT, if the
+    /// mapper asked for it with enable_scanline_counter()
+    virtual void clock_scanline() {}
+
+    /// write the mapper registers to (at most REGISTERS_SIZE bytes of) data
+    virtual void save_registers(u8 *data) const = 0;
+
+    /// restore what save_registers() wrote and remap the banks it selects
+    virtual void load_registers(const u8 *data) = 0;
+
+    // bank switching, banks wrap around the size of the rom (which the Rom keeps at a power of
+    // two). slots count from the start of the window, i.e. $8000 for PRG and $0000 for CHR
+
+    void map_prg_8k(u32 slot, u32 bank);
+    void map_prg_16k(u32 slot, u32 bank);
+    void map_prg_32k(u32 bank);
+
+    void map_chr_1k(u32 slot, u32 bank);
+    void map_chr_2k(u32 slot, u32 bank);
+    void map_chr_4k(u32 slot, u32 bank);
+    void map_chr_8k(u32 bank);
+
+    void set_mirroring(Rom::ScreenMirroring mirroring);
+
+    /// hold or release the cpu IRQ line
+    void set_irq(bool asserted);
+
+    /// start calling clock_scanline()
+    void enable_scanline_counter();
+
+    inline u32 get_prg_bank_count() const {
+        return prgBankMask + 1;
+    }
+
+    inline u32 get_chr_bank_count() const {
+        return chrBankMask + 1;
+    }
+
+protected:
+    const Rom *rom; // shared image, kept alive by the Core
+
+    Bus *bus             = nullptr;
+    Ppu *ppu             = nullptr;
+    Cpu *cpu             = nullptr;
+    Scheduler *scheduler = nullptr;
+
+private:
+    u32 prgBankMask; // 8 KiB bank count - 1
+    u32 chrBankMask; // 1 KiB bank count - 1
+
+    std::vector<u8> prgRam; // only allocated for cartridges with PRG RAM
+    std::vector<u8> chrRam; // only allocated for cartridges with CHR RAM
+    const u8 *chrData;      // CHR ROM of the shared image, or chrRam
+
+    static u8 read_cartridge(void *context, u16 address);
+    static void write_cartridge(void *context, u16 address, u8 data);
+
+    static void on_scanline_counter(void *context, u64 timestamp);
+};
+
+} // namespace nes
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "nes/mapper.hpp"
+
+namespace nes {
+
+/// Mapper 3. fixed 16 or 32 KiB of PRG ROM, switchable 8 KiB CHR bank
+class Cnrom : public Mapper {
+public:
+    explicit Cnrom(const Rom *rom) : Mapper(rom) {}
+
+protected:
+    void power_on() override;
+
+    void write_register(u16 address, u8 data) override;
+
+    void save_registers(u8 *data) const override;
+
+    void load_registers(const u8 *data) override;
+
+private:
+    u8 chrBank = 0;
+};
+
+} // namespace nes
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "nes/mapper.hpp"
+
+namespace nes {
+
+/// Mapper 1 (SxROM). registers are loaded one bit at a time through a 5 bit shift register.
+/// 16 / 32 KiB PRG banking, 4 / 8 KiB CHR banking and mapper controlled mirroring. the 512 KiB
+/// SUROM layout uses bit 4 of the CHR bank registers to select the PRG ROM half
+class Mmc1 : public Mapper {
+public:
+    explicit Mmc1(const Rom *rom) : Mapper(rom) {}
+
+protected:
+    void power_on() override;
+
+    void write_register(u16 address, u8 data) override;
+
+    void save_registers(u8 *data) const override;
+
+    void load_registers(const u8 *data) override;
+
+private:
+    u8 shift    = 0x10; // the 1 marks where the shift register is full
+    u8 control  = 0x0C;
+    u8 chrBank0 = 0;
+    u8 chrBank1 = 0;
+    u8 prgBank  = 0;
+
+    void update_banks();
+};
+
+} // namespace nes
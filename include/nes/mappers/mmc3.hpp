@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+
+#include "nes/mapper.hpp"
+
+namespace nes {
+
+/// Mapper 4 (TxROM). 8 KiB PRG and 1 / 2 KiB CHR banking through eight bank registers, and a
+/// scanline counter that raises an IRQ, clocked by the scheduler once per rendered line
+class Mmc3 : public Mapper {
+public:
+    explicit Mmc3(const Rom *rom) : Mapper(rom) {}
+
+protected:
+    void power_on() override;
+
+    void write_register(u16 address, u8 data) override;
+
+    void save_registers(u8 *data) const override;
+
+    void load_registers(const u8 *data) override;
+
+    void clock_scanline() override;
+
+private:
+    u8 bankSelect           = 0;
+    std::array<u8, 8> banks = {};
+
+    u8 irqLatch     = 0;
+    u8 irqCounter   = 0;
+    bool irqReload  = false;
+    bool irqEnabled = false;
+
+    void update_banks();
+};
+
+} // namespace nes
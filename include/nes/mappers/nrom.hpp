@@ -0,0 +1,22 @@
+#pragma once
+
+#include "nes/mapper.hpp"
+
+namespace nes {
+
+/// Mapper 0. 16 or 32 KiB of PRG ROM and 8 KiB of CHR, no bank switching
+class Nrom : public Mapper {
+public:
+    explicit Nrom(const Rom *rom) : Mapper(rom) {}
+
+protected:
+    void power_on() override;
+
+    void write_register(u16 address, u8 data) override;
+
+    void save_registers(u8 *data) const override;
+
+    void load_registers(const u8 *data) override;
+};
+
+} // namespace nes
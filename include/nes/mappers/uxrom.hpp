@@ -0,0 +1,25 @@
+#pragma once
+
+#include "nes/mapper.hpp"
+
+namespace nes {
+
+/// Mapper 2. switchable 16 KiB PRG bank at $8000, last bank fixed at $C000, 8 KiB of CHR
+class Uxrom : public Mapper {
+public:
+    explicit Uxrom(const Rom *rom) : Mapper(rom) {}
+
+protected:
+    void power_on() override;
+
+    void write_register(u16 address, u8 data) override;
+
+    void save_registers(u8 *data) const override;
+
+    void load_registers(const u8 *data) override;
+
+private:
+    u8 prgBank = 0;
+};
+
+} // namespace nes
@@ -29,6 +29,15 @@ public:
     /// write two bytes to mem at the given address
     void write_u16(u16 data, u16 address);
 
+    /// direct pointer to the underlying storage, used by the bus for page mapping
+    inline u8 *data() {
+        return memory.data();
+    }
+
+    inline const u8 *data() const {
+        return memory.data();
+    }
+
 private:
     std::array<u8, MEM_SIZE_BYTES> memory = {};
 };
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "common/types.hpp"
+#include "nes/core.hpp"
+
+namespace nes {
+
+/// bumped whenever the layout of a movie file changes
+static constexpr u32 MOVIE_VERSION = 1;
+
+/// A recorded input movie: the state it starts from, the buttons held on both ports every frame,
+/// and a rolling hash of RAM and the frame buffer every checkpointInterval frames.
+///
+/// Replaying a movie on a different build checks that the build emulates exactly like the one
+/// that recorded it, which makes movies regression tests for changes that shouldn't change
+/// behaviour. On disk the input is run length encoded, held buttons rarely change every frame.
+struct Movie {
+    static constexpr u32 DEFAULT_CHECKPOINT_INTERVAL = 60;
+
+    u32 romCrc32           = 0;
+    u32 checkpointInterval = DEFAULT_CHECKPOINT_INTERVAL;
+
+    std::vector<u8> startState;                       // Core::save_state() at the first frame
+    std::vector<std::array<u8, 2>> input;             // buttons per frame, port 1 and port 2
+    std::vector<u32> checkpoints;                     // hash after every checkpointInterval frames
+
+    bool save(const std::string &filepath) const;
+
+    /// load a movie to replay on the given core, which must have the movie's rom loaded. the
+    /// file is checked against its header and the core's save state size before anything is
+    /// allocated for it
+    bool load(const std::string &filepath, const Core &core);
+
+    /// extend the rolling hash with the current RAM and frame buffer of the core
+    static u32 hash_state(const Core &core, u32 hash);
+};
+
+/// Records a Movie while the core runs
+class MovieRecorder {
+public:
+    /// start a movie from the core's current state
+    MovieRecorder(Core &core, Movie &movie,
+                  u32 checkpointInterval = Movie::DEFAULT_CHECKPOINT_INTERVAL);
+
+    /// run one frame with the given buttons held and record it
+    void run_frame(u8 port1, u8 port2);
+
+private:
+    Core &core;
+    Movie &movie;
+
+    u32 hash = 0;
+};
+
+/// Outcome of replay_movie()
+struct ReplayResult {
+    bool ok;
+    u64 frames;          // frames replayed
+    u32 checkpoints;     // checkpoints that matched
+    u64 mismatchFrame;   // frame after which the first mismatching checkpoint was taken
+};
+
+/// replay a movie headless as fast as possible, stopping at the first checkpoint that doesn't
+/// match. the core must have the movie's rom loaded. only ok if the movie has a checkpoint for
+/// every checkpointInterval frames and all of them matched
+ReplayResult replay_movie(Core &core, const Movie &movie);
+
+} // namespace nes
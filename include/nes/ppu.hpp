@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+
+#include "common/types.hpp"
+#include "nes/rom.hpp"
+#include "nes/scheduler.hpp"
+
+namespace nes {
+
+/// The picture processing unit.
+///
+/// Rendering happens a whole scanline at a time when the scheduler reaches the start of that
+/// scanline, instead of dot by dot. Each line is built from 8 pixel tile rows expanded through a
+/// lookup table, and the output is a 256x240 buffer of palette indices. Conversion to RGBA goes
+/// through a second lookup table and only happens when a frame is actually presented.
+class Ppu {
+public:
+    static constexpr u32 SCREEN_WIDTH  = 256;
+    static constexpr u32 SCREEN_HEIGHT = 240;
+
+    static constexpr u32 DOTS_PER_SCANLINE   = 341;
+    static constexpr u32 SCANLINES_PER_FRAME = 262;
+
+    static constexpr u64 MASTER_CYCLES_PER_SCANLINE =
+        DOTS_PER_SCANLINE * Scheduler::MASTER_CYCLES_PER_PPU_DOT;
+
+    /// all mutable ppu state, see Core::save_state. the pattern table mapping belongs to the
+    /// mapper and the rendered frame is output, so neither is included
+    struct State {
+        u8 ctrl, mask, status, oamAddr;
+        u16 v, t;
+        u8 fineX;
+        bool w;
+        u8 readBuffer, latch;
+        Rom::ScreenMirroring mirroring;
+        u32 scanline;
+        u64 lineTimestamp;
+        u64 frameCount;
+        std::array<u8, 4096> vram;
+        std::array<u8, 32> palette;
+        std::array<u8, 256> oam;
+    };
+
+    Ppu();
+
+    void save_state(State &state) const;
+    void load_state(const State &state);
+
+    /// register with the scheduler and start rendering from the current master clock time
+    void attach(Scheduler *scheduler);
+
+    void reset();
+
+    /// cpu side register access, $2000-$2007 (mirrored up to $3FFF)
+    u8 read_register(u16 address);
+    void write_register(u16 address, u8 data);
+
+    /// OAM DMA, 256 bytes written through OAMDATA in one go: from OAMADDR on, wrapping around
+    void write_oam_dma(const u8 *data);
+
+    /// ppu address space access, $0000-$3FFF
+    u8 read_vram(u16 address);
+    void write_vram(u16 address, u8 data);
+
+    /// map a 1 KiB pattern table page, $0000-$1FFF in 8 pages. used by mappers for CHR banking.
+    /// a nullptr write page makes the page read only (CHR ROM)
+    void map_chr_page(u8 page, const u8 *read, u8 *write);
+
+    /// select which of the internal nametables appear at $2000, $2400, $2800 and $2C00
+    void set_mirroring(Rom::ScreenMirroring mirroring);
+
+    /// line the ppu is currently on, 0-239 visible, 241 vblank start, 261 pre-render
+    inline u32 get_scanline() const {
+        return scanline;
+    }
+
+    /// master clock time the current line started
+    inline u64 get_line_timestamp() const {
+        return lineTimestamp;
+    }
+
+    /// true if either the background or sprites are enabled
+    inline bool rendering_enabled() const {
+        return (mask & 0x18) != 0;
+    }
+
+    /// master clock time at which the next vertical blank (i.e. the end of the current frame)
+    /// starts
+    u64 get_next_vblank() const;
+
+    /// palette indices (0-63) of the last rendered frame, SCREEN_WIDTH * SCREEN_HEIGHT bytes
+    inline const u8 *get_frame() const {
+        return output;
+    }
+
+    /// render into the given SCREEN_WIDTH * SCREEN_HEIGHT buffer instead of the ppu's own, e.g.
+    /// straight into a caller's observation buffer. nullptr goes back to the ppu's own buffer
+    void set_output(u8 *buffer);
+
+    /// convert the last rendered frame to RGBA8 (R, G, B, A in memory order)
+    void frame_to_rgba(u32 *pixels) const;
+
+    /// build the background and sprite layers of a visible line from the current state, in the
+    /// format the composite kernels take (see ppu_composite.hpp). also used for benchmarking
+    void render_layers(u32 line, u8 *bgPixels, u8 *spPixels);
+
+public:
+    std::array<u8, 256> oam = {}; // object attribute memory, 64 sprites
+
+    u64 frameCount = 0; // number of frames completed
+
+private:
+    Scheduler *scheduler = nullptr;
+
+    // registers
+
+    u8 ctrl    = 0; // $2000
+    u8 mask    = 0; // $2001
+    u8 status  = 0; // $2002
+    u8 oamAddr = 0; // $2003
+
+    u16 v         = 0;     // current vram address
+    u16 t         = 0;     // temporary vram address
+    u8 fineX      = 0;     // fine x scroll
+    bool w        = false; // first / second write toggle
+    u8 readBuffer = 0;     // PPUDATA read buffer
+    u8 latch      = 0;     // last value written to any register (open bus)
+
+    // memory
+
+    std::array<u8, 4096> vram          = {}; // nametables, 4 KiB for four screen cartridges
+    std::array<u8, 32> palette         = {};
+    std::array<u8 *, 4> nametables     = {};
+    std::array<const u8 *, 8> chrPages = {};
+    std::array<u8 *, 8> chrWritePages  = {};
+
+    Rom::ScreenMirroring mirroring = Rom::sm_HORIZONTAL; // nametable layout
+
+    // timing
+
+    u32 scanline      = SCANLINES_PER_FRAME - 1; // line the ppu is currently on
+    u64 lineTimestamp = 0;                         // master clock time the current line started
+
+    // output
+
+    std::array<u8, SCREEN_WIDTH * SCREEN_HEIGHT> frame = {};
+    u8 *output                                         = frame.data(); // where lines are rendered
+    std::array<u8, SCREEN_HEIGHT> lineEmphasis         = {}; // colour emphasis bits per line
+
+    static void on_scanline(void *context, u64 timestamp);
+
+    void render_scanline(u32 line);
+
+    void render_background(u8 *pixels);
+
+    void render_sprites(u32 line, u8 *pixels);
+
+    inline u8 read_chr(u16 address) const {
+        return chrPages[address >> 10][address & 0x3FF];
+    }
+
+    inline u8 &nametable_at(u16 address) {
+        return nametables[(address >> 10) & 0x03][address & 0x3FF];
+    }
+};
+
+} // namespace nes
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "common/types.hpp"
+
+namespace nes {
+
+/// Merges the background and sprite layers of one 256 pixel scanline into palette indices.
+///
+/// Layer pixels hold a palette address in the low 5 bits (0x00-0x0F background, 0x10-0x1F
+/// sprites, transparent if the low 2 bits are 0). Sprite pixels additionally carry the "behind
+/// background" priority in bit 6 and a sprite 0 marker in bit 7. The left 8 pixels of each layer
+/// are ANDed with the matching mask (0x00 to hide them, 0xFF to show them). Output pixels are
+/// palette[address] & greyscale.
+///
+/// Returns true if an opaque sprite 0 pixel overlapped an opaque background pixel (x < 255).
+using CompositeKernel = bool (*)(const u8 *bg, const u8 *sp, const u8 *palette, u8 bgLeftMask,
+                                 u8 spLeftMask, u8 greyscale, u8 *out);
+
+/// Instruction set a composite kernel is built for
+enum CompositeLevel {
+    cl_SCALAR,
+    cl_SSE2,
+    cl_AVX2,
+};
+
+/// Kernel for the given instruction set, or nullptr if it is unavailable on this build or cpu
+CompositeKernel get_composite_kernel(CompositeLevel level);
+
+/// Fastest kernel supported by the running cpu
+CompositeKernel get_best_composite_kernel();
+
+} // namespace nes
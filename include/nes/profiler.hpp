@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/types.hpp"
+#include "nes/bus.hpp"
+#include "nes/instructions.hpp"
+
+namespace nes {
+
+/// Which histogram Profiler::write_csv exports
+enum ProfileTable : u8 {
+    prof_OPCODES, // one row per opcode byte
+    prof_MODES,   // one row per addressing mode
+    prof_PCS,     // one row per instruction address, bucketed by PRG bank
+};
+
+/// Guest code profiler: executions and cycles per opcode, per addressing mode and per PC.
+///
+/// Runs while Cpu::profiler points at it. BlockCache::run picks its instrumented loop once per
+/// batch when a profiler or trace is attached, so with neither attached the dispatch loop has no
+/// trace of it. The cycles of an instruction include any DMA stall it started.
+///
+/// ROM addresses are bucketed by the 8 KiB PRG bank mapped there when they ran, the smallest
+/// bank size of any mapper, so the same address in different banks stays apart. A shadow call
+/// stack follows JSR and BRK / RTS and RTI, and treats any other jump the instruction stream
+/// doesn't explain (an interrupt, a reset) as a call, for flame graphs of where the cycles go.
+///
+/// Only the real timeline is profiled: RunAhead detaches the profiler for its speculative frames.
+/// Any other state load calls resync(), which drops the shadow call stack back to the root.
+class Profiler {
+public:
+    /// deepest shadow call stack kept, deeper calls are charged to the deepest frame
+    static constexpr u32 MAX_DEPTH = 64;
+
+    /// PRG bucket size
+    static constexpr u32 BANK_SIZE = 0x2000;
+
+    struct Counter {
+        u64 executions;
+        u64 cycles;
+    };
+
+    /// profile the cpu behind the given bus, bucketing addresses mapped into the given PRG ROM
+    /// (Rom::get_prg_data()) by bank. the rom has to stay loaded while the profiler is attached
+    Profiler(const Bus &bus, const u8 *prg, u32 prgSize);
+
+    Profiler(const Profiler &)            = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    /// forget everything counted so far
+    void clear();
+
+    /// the cpu was moved to pc by something other than an instruction, e.g. a loaded state. the
+    /// old call stack no longer means anything, so counting carries on from the root
+    void resync(u16 pc);
+
+    /// count one executed instruction, nextPC is where the cpu went afterwards
+    inline void record(u16 pc, u8 opcode, u64 cycles, u16 nextPC) {
+        const u8 *page = bus->get_read_page(pc >> 8);
+        if (pc != expectedPC) {
+            // the cpu went somewhere no instruction sent it
+            push_frame(location(pc));
+        }
+        expectedPC = nextPC;
+
+        opcodes[opcode].executions++;
+        opcodes[opcode].cycles += cycles;
+
+        Site &site = site_for(pc, page);
+        site.counter.executions++;
+        site.counter.cycles += cycles;
+        site.pc     = pc;
+        site.opcode = opcode;
+
+        nodeCycles[node] += cycles;
+
+        if (opcode == 0x20 || opcode == 0x00) { // JSR, BRK
+            push_frame(location(nextPC));
+        } else if (opcode == 0x60 || opcode == 0x40) { // RTS, RTI
+            pop_frame();
+        }
+    }
+
+    inline const std::array<Counter, 256> &get_opcodes() const {
+        return opcodes;
+    }
+
+    /// the opcode counts summed by addressing mode
+    std::array<Counter, am_ZPY + 1> get_modes() const;
+
+    bool write_csv(const std::string &path, ProfileTable table) const;
+
+    /// folded stacks ("frame;frame;frame cycles" per line), the input of flamegraph.pl and
+    /// most flame graph viewers
+    bool write_folded(const std::string &path) const;
+
+private:
+    /// an instruction address, with the bank it ran from if that was PRG ROM
+    struct Site {
+        Counter counter;
+        u16 pc;
+        u8 opcode;
+    };
+
+    /// a distinct call stack, see nodeCycles
+    struct Node {
+        u32 parent;
+        u32 location; // routine entry, see location()
+    };
+
+    const Bus *bus;
+    const u8 *prgData;
+    u32 prgSize;
+
+    std::array<Counter, 256> opcodes = {};
+
+    std::vector<Site> romSites;   // indexed by PRG offset
+    std::vector<Site> otherSites; // RAM, registers and anything else, indexed by address
+
+    // the call stacks form a tree, node 0 is the root. the current stack is a node and its
+    // ancestors, so an instruction is a single add into nodeCycles
+    std::vector<Node> nodes;
+    std::vector<u64> nodeCycles;
+    std::unordered_map<u64, u32> children; // parent << 32 | location to node
+    u32 node  = 0;
+    u32 depth = 0;
+
+    u16 expectedPC = 0;
+
+    bool in_prg(const u8 *page) const {
+        return page != nullptr && page >= prgData && page < prgData + prgSize;
+    }
+
+    /// bank << 16 | address with the top bit set for PRG ROM, otherwise just the address
+    u32 location(u16 pc) const;
+
+    inline Site &site_for(u16 pc, const u8 *page) {
+        if (in_prg(page)) {
+            return romSites[(page - prgData) + (pc & 0xFF)];
+        }
+        return otherSites[pc];
+    }
+
+    void push_frame(u32 location);
+    void pop_frame();
+
+    std::string format_location(u32 location) const;
+};
+
+} // namespace nes
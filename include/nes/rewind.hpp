@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+
+#include "common/types.hpp"
+#include "nes/core.hpp"
+
+namespace nes {
+
+/// Rewind history, a fixed size ring of per frame save states.
+///
+/// Every keyframeInterval frames a keyframe is stored, and the frames in between are stored as
+/// the XOR against their keyframe. Most of the state (RAM, VRAM, PRG RAM) barely changes from
+/// frame to frame, so the XOR is mostly zeros, which are run length encoded away. When the ring
+/// is full the oldest frames are dropped, along with any deltas that lose their keyframe.
+///
+/// All memory is allocated up front, push() and pop() never allocate. The history is tied to the
+/// rom that was loaded when it was created.
+class Rewind {
+public:
+    static constexpr u32 DEFAULT_KEYFRAME_INTERVAL = 60;
+
+    /// capacity is the size of the frame ring in bytes
+    Rewind(Core &core, size_t capacity, u32 keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+
+    Rewind(const Rewind &)            = delete;
+    Rewind &operator=(const Rewind &) = delete;
+
+    /// capture the current state of the core, call once per frame
+    void push();
+
+    /// restore the most recently captured frame and drop it from the history. returns false if
+    /// the history is empty
+    bool pop();
+
+    void clear();
+
+    /// number of frames that can currently be rewound
+    inline u64 get_frame_count() const {
+        return head - tail;
+    }
+
+    /// bytes of the ring used by stored frames
+    inline size_t get_used_bytes() const {
+        return usedBytes;
+    }
+
+public:
+    u64 keyframes     = 0; // keyframes pushed
+    u64 deltas        = 0; // delta frames pushed
+    u64 keyframeBytes = 0; // encoded size of all pushed keyframes
+    u64 deltaBytes    = 0; // encoded size of all pushed delta frames
+
+private:
+    struct Record {
+        u32 offset;   // in the ring
+        u32 size;     // encoded size
+        u64 keyframe; // sequence number of the keyframe this frame is a delta against
+    };
+
+    Core &core;
+
+    u32 keyframeInterval;
+    size_t stateSize;
+
+    std::vector<u8> ring;
+    std::vector<Record> records; // indexed by sequence number modulo its size
+
+    u64 head        = 0; // sequence number of the next frame
+    u64 tail        = 0; // sequence number of the oldest frame
+    u32 writeOffset = 0; // ring offset of the next frame
+    size_t usedBytes = 0;
+
+    // encoder side, the raw state of the keyframe new frames are encoded against
+    std::vector<u8> keyframeState;
+    u64 keyframeSequence = 0;
+    bool needKeyframe    = true;
+
+    // decoder side, the raw state of the keyframe decoded last
+    std::vector<u8> decodedKeyframe;
+    u64 decodedSequence = ~0ULL;
+
+    std::vector<u8> zeros;   // keyframes are encoded as a delta against zeros
+    std::vector<u8> current; // scratch for the state being pushed / popped
+    std::vector<u8> encoded; // scratch for the encoded frame, worst case size
+
+    inline Record &record(u64 sequence) {
+        return records[sequence % records.size()];
+    }
+
+    /// drop the oldest frame
+    void evict();
+
+    /// make room for size bytes at the write offset
+    bool reserve(u32 size);
+
+    /// XOR the state against the key and run length encode the result into out. returns the
+    /// encoded size
+    static size_t encode(const u8 *state, const u8 *key, size_t size, u8 *out);
+
+    /// inverse of encode(), out must not alias key
+    static void decode(const u8 *in, const u8 *key, size_t size, u8 *out);
+};
+
+} // namespace nes
@@ -4,38 +4,112 @@
 #include <vector>
 
 #include "common/types.hpp"
+#include "nes/mapped_file.hpp"
 
 namespace nes {
 
+class RomDatabase;
+
+/// A cartridge image loaded from an iNES / NES 2.0 file.
+///
+/// The file is memory mapped and PRG / CHR ROM are views into the mapping, so loading is
+/// zero-copy. Only images that aren't a power of two in size are copied, to pad them (see
+/// get_prg_data()). A Rom is immutable once loaded, so one image can be shared by any number of
+/// cores (see Core::load_rom). Cartridge RAM is per instance and belongs to the Mapper, the Rom
+/// only says how much there is.
 class Rom {
 public:
-    Rom(const char *romFile);
+    typedef enum ScreenMirroring {
+        sm_UNDEFINED,
+        sm_VERTICAL,
+        sm_HORIZONTAL,
+        sm_FOUR_SCREEN,
+        sm_SINGLE_SCREEN,       // first nametable only
+        sm_SINGLE_SCREEN_UPPER, // second nametable only
+    } sm;
+
+    /// size of the optional trainer, loaded to $7000-$71FF
+    static constexpr u32 TRAINER_SIZE = 512;
+
+    /// load the given file. if a database is given, header fields are corrected from the entry
+    /// matching the CRC-32 of the rom data
+    Rom(const char *romFile, const RomDatabase *database = nullptr);
 
     inline bool is_ok() const {
         return romStatusOk;
     }
 
-    u8 read_prg_u8(u16 address);
-    u8 read_chr_u8(u16 address);
+    /// iNES mapper number
+    inline u16 get_mapper_id() const {
+        return mapperId;
+    }
 
-    void write_prg_u8(u16 address, u8 data);
-    void write_chr_u8(u16 address, u8 data);
+    /// PRG ROM, 16 KiB or more and mirrored up to a power of two
+    inline const u8 *get_prg_data() const {
+        return prgData;
+    }
+
+    inline u32 get_prg_size() const {
+        return prgSize;
+    }
+
+    /// CHR ROM, 8 KiB or more and mirrored up to a power of two. nullptr if the cartridge has
+    /// CHR RAM instead
+    inline const u8 *get_chr_data() const {
+        return chrData;
+    }
+
+    /// size of the CHR ROM, or of the CHR RAM the cartridge comes with
+    inline u32 get_chr_size() const {
+        return chrSize;
+    }
+
+    /// TRAINER_SIZE bytes, or nullptr if the rom has no trainer
+    inline const u8 *get_trainer() const {
+        return trainer;
+    }
+
+    inline sm get_mirroring() const {
+        return mirror;
+    }
+
+    /// PRG RAM at $6000-$7FFF, work RAM and battery backed RAM together. a power of two from 256
+    /// bytes to 8 KiB, or 0 if the cartridge has none
+    inline u32 get_prg_ram_size() const {
+        return prgRamSize;
+    }
+
+    /// cartridges without CHR ROM come with (at least 8 KiB of) CHR RAM instead
+    inline bool has_chr_ram() const {
+        return chrData == nullptr;
+    }
+
+    /// CRC-32 of the PRG and CHR ROM as stored in the file, i.e. without header or trainer. this
+    /// is what rom databases are keyed by
+    inline u32 get_crc32() const {
+        return crc;
+    }
 
 private:
-    typedef enum ScreenMirroring {
-        sm_UNDEFINED,
-        sm_VERTICAL,
-        sm_HORIZONTAL,
-        sm_FOUR_SCREEN,
-        sm_SINGLE_SCREEN, // may remain unused
-    } sm;
+    sm mirror    = sm_UNDEFINED;
+    u16 mapperId = 0;
+
+    MappedFile file;
+
+    const u8 *prgData = nullptr;
+    const u8 *chrData = nullptr;
+    const u8 *trainer = nullptr;
+    u32 prgSize       = 0;
+    u32 chrSize       = 0;
+    u32 prgRamSize    = 0;
 
-    sm mirror = sm_UNDEFINED;
+    // only used by images that had to be padded
+    std::vector<u8> prgCopy;
+    std::vector<u8> chrCopy;
 
-    std::vector<u8> prgMem;
-    std::vector<u8> chrMem;
+    u32 crc = 0;
 
     bool romStatusOk = false;
 };
 
-} // namespace nes
\ No newline at end of file
+} // namespace nes
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+#include "common/types.hpp"
+#include "nes/rom.hpp"
+
+namespace nes {
+
+/// Corrections for roms with wrong or incomplete headers, keyed by the CRC-32 of the PRG and CHR
+/// data (see Rom::get_crc32()).
+///
+/// The database is a text file with one rom per line, `<crc32> <mapper> <mirroring> [prg ram]`,
+/// where the CRC is 8 hex digits, mirroring is one of H, V, 4 or - to keep what the header says,
+/// and the optional PRG RAM size is in KiB (0 for none) or - as well. Everything after a # is a
+/// comment.
+class RomDatabase {
+public:
+    /// Entry::prgRamSize that keeps the header value
+    static constexpr u32 KEEP_PRG_RAM = ~0u;
+
+    struct Entry {
+        u32 crc32;
+        u16 mapperId;
+        Rom::ScreenMirroring mirroring; // sm_UNDEFINED keeps the header value
+        u32 prgRamSize;                 // bytes, or KEEP_PRG_RAM
+    };
+
+    RomDatabase() = default;
+
+    /// add the entries of the given file. returns false if it can't be read or has a bad line
+    bool load(const char *file);
+
+    /// entry for the given CRC-32, or nullptr if there is none
+    const Entry *find(u32 crc32) const;
+
+    inline size_t size() const {
+        return entries.size();
+    }
+
+private:
+    std::vector<Entry> entries; // sorted by crc32
+};
+
+} // namespace nes
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+
+#include "common/types.hpp"
+#include "nes/core.hpp"
+
+namespace nes {
+
+/// Run-ahead input latency reduction.
+///
+/// Games typically take one or more frames to react to input. Each frame, run_frame() runs the
+/// real timeline forward by one frame, snapshots it, runs a further N frames with the same input,
+/// keeps the video of the last one and restores the snapshot. The presented frame is then N
+/// frames "in the future", hiding N frames of the game's own lag.
+///
+/// Only the real frame may produce side effects for the host, anything observed during the
+/// speculative frames (audio in particular) is thrown away by the restore.
+class RunAhead {
+public:
+    /// upper bound for the number of frames run ahead
+    static constexpr u32 MAX_FRAMES = 8;
+
+    explicit RunAhead(Core &core);
+
+    RunAhead(const RunAhead &)            = delete;
+    RunAhead &operator=(const RunAhead &) = delete;
+
+    /// run one real frame and frames speculative ones, with the input currently set on
+    /// core.controllers. afterwards core.ppu.get_frame() holds the frame to present
+    void run_frame();
+
+    inline void set_frames(u32 n) {
+        frames = n < MAX_FRAMES ? n : MAX_FRAMES;
+    }
+
+    inline u32 get_frames() const {
+        return frames;
+    }
+
+    /// pick the most frames (up to maxFrames) that fit in the given host frame budget, based on
+    /// the measured costs. some of the budget is left over for presenting and jitter
+    void tune(double budgetSeconds, u32 maxFrames = MAX_FRAMES);
+
+    /// measured cost of a real frame, in seconds (moving average)
+    inline double get_real_frame_cost() const {
+        return realFrameCost;
+    }
+
+    /// measured cost of each frame run ahead, including its share of the snapshot and restore, in
+    /// seconds (moving average)
+    inline double get_ahead_frame_cost() const {
+        return aheadFrameCost;
+    }
+
+    /// total cost of the last run_frame(), in seconds
+    inline double get_last_cost() const {
+        return lastCost;
+    }
+
+private:
+    Core &core;
+
+    u32 frames = 1;
+
+    std::vector<u8> state; // snapshot of the real timeline
+
+    double realFrameCost  = 0.0;
+    double aheadFrameCost = 0.0;
+    double lastCost       = 0.0;
+};
+
+} // namespace nes
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+
+#include "common/types.hpp"
+#include "nes/block_cache.hpp"
+#include "nes/cpu.hpp"
+
+namespace nes {
+
+/// Events that can interrupt a batch of cpu instructions
+enum EventType {
+    ev_PPU_SCANLINE,      // start of the next PPU scanline
+    ev_NMI,               // vblank non-maskable interrupt
+    ev_APU_FRAME_COUNTER, // APU frame counter step
+    ev_DMA,               // DMC sample fetch, OAM DMA runs right at its $4014 write
+    ev_MAPPER,            // mapper scanline counter
+    ev_COUNT,
+};
+
+/// Callback for a scheduled event, timestamp is the master clock time the event was due at
+using EventCallback = void (*)(void *context, u64 timestamp);
+
+/// Master clock scheduler.
+///
+/// Time is kept in master clock ticks (21.477 MHz NTSC), so both the CPU (12 ticks per cycle)
+/// and the PPU (4 ticks per dot) land on whole numbers. Instead of stepping every component in
+/// lockstep, the cpu runs in instruction batches up to the nearest pending event. Other
+/// components are expected to catch up lazily to now() when they are accessed or when their
+/// event fires.
+class Scheduler {
+public:
+    static constexpr u64 MASTER_CYCLES_PER_CPU_CYCLE = 12;
+    static constexpr u64 MASTER_CYCLES_PER_PPU_DOT   = 4;
+
+    /// master clock ticks in one NTSC frame, 262 scanlines of 341 dots
+    static constexpr u64 MASTER_CYCLES_PER_FRAME = 262 * 341 * MASTER_CYCLES_PER_PPU_DOT;
+
+    /// deadline of an event that is not scheduled
+    static constexpr u64 NEVER = ~0ULL;
+
+    /// pending deadlines, see Core::save_state. handlers are wiring and not part of the state
+    struct State {
+        std::array<u64, ev_COUNT> deadlines;
+    };
+
+    Scheduler() = default;
+
+    void save_state(State &state) const;
+    void load_state(const State &state);
+
+    void attach(Cpu *cpu, BlockCache *blockCache);
+
+    /// set the function called when the given event fires
+    void set_handler(EventType event, EventCallback callback, void *context);
+
+    /// schedule (or reschedule) an event at the given master clock time. each event type has at
+    /// most one pending deadline. if the event is due before the running cpu batch would end, the
+    /// batch stops early after the current instruction
+    void schedule(EventType event, u64 timestamp);
+
+    void cancel(EventType event);
+
+    /// stop the running cpu batch after the current instruction, e.g. because the memory the
+    /// batch is executing from was banked out
+    inline void interrupt_batch() {
+        blockCache->yield();
+    }
+
+    /// run the cpu and fire due events until the master clock reaches the given time. the cpu
+    /// finishes its current instruction, so this may overshoot by a few cycles
+    void run_until(u64 timestamp);
+
+    /// current master clock time. the cpu is the only component that is always up to date, so the
+    /// master clock is derived from the cycles it has executed
+    inline u64 now() const {
+        return cpu->cyclesExecuted * MASTER_CYCLES_PER_CPU_CYCLE;
+    }
+
+private:
+    struct Event {
+        u64 deadline           = NEVER;
+        EventCallback callback = nullptr;
+        void *context          = nullptr;
+    };
+
+    Cpu *cpu               = nullptr;
+    BlockCache *blockCache = nullptr;
+
+    std::array<Event, ev_COUNT> events = {};
+
+    u64 nextDeadline = NEVER; // earliest pending event
+    u64 batchEnd     = 0;     // master clock time the running cpu batch stops at
+
+    void dispatch_due_events();
+
+    void update_next_deadline();
+};
+
+} // namespace nes
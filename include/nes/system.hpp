@@ -1,13 +1,65 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
-#include "nes/bus.hpp"
-#include "nes/cpu.hpp"
-#include "nes/memory.hpp"
+#include "common/audio_ring.hpp"
+#include "common/spsc_queue.hpp"
+#include "common/triple_buffer.hpp"
+#include "nes/core.hpp"
+#include "nes/debug_overlay.hpp"
+#include "nes/run_ahead.hpp"
+#include "nes/trace_ring.hpp"
 
 namespace nes {
 
+/// Commands from the UI thread to the emulation thread
+enum CommandType : u8 {
+    cmd_BUTTONS,         // value = Button bits held on port 1
+    cmd_STEP,            // execute one instruction
+    cmd_FRAME,           // run one frame
+    cmd_RESET,
+    cmd_IRQ,
+    cmd_NMI,
+    cmd_SAVE_STATE,
+    cmd_LOAD_STATE,
+    cmd_PLAY,            // toggle running frames at the NES frame rate
+    cmd_FAST_FORWARD,    // toggle running frames as fast as possible
+    cmd_RUN_AHEAD_MORE,  // one more run-ahead frame
+    cmd_RUN_AHEAD_LESS,  // one less run-ahead frame
+    cmd_AUTO_RUN_AHEAD,  // toggle tuning the run-ahead frames against the frame budget
+};
+
+struct Command {
+    CommandType type;
+    u32 value;
+};
+
+/// Everything the UI shows of one emulated frame
+struct VideoFrame {
+    std::array<u32, Ppu::SCREEN_WIDTH * Ppu::SCREEN_HEIGHT> pixels;
+
+    Cpu cpu; // copy of the cpu at the end of the frame, for the debug overlay
+
+    u64 frameCount;
+    u32 runAheadFrames;
+    bool running;
+    bool fastForward;
+    bool autoRunAhead;
+    double frameCost; // seconds spent emulating the frame, including run-ahead
+};
+
+/// The raylib front-end.
+///
+/// The core runs on its own emulation thread, paced to the NES frame rate (or not at all when
+/// fast forwarding) independent of the monitor refresh. Finished frames are handed to the UI
+/// thread through a triple buffer and input flows back through a command queue, so neither
+/// thread ever waits on the other. Audio goes to the device callback through a ring the same
+/// way, with the apu's output rate nudged to keep that ring half full.
 class System {
 public:
     System();
@@ -15,17 +67,65 @@ public:
 
     void run();
 
+    /// load a rom, must be called before run()
     void load_rom(const std::string& filepath);
 
 private:
-    Bus bus;
-    Cpu cpu;
-    Mem mem;
-    Rom *rom = nullptr;
+    // owned by the emulation thread while it runs
+
+    Core core;
+
+    RomDatabase romDatabase;
+
+    RunAhead runAhead;
+
+    bool running      = false; // run frames at the NES frame rate instead of stepping by hand
+    bool fastForward  = false; // run frames as fast as possible
+    bool autoRunAhead = false; // tune the run-ahead frames against the frame budget
+    u32 runAheadLimit = 1;     // run-ahead frames set by hand, the cap while tuning
+
+    std::vector<int16_t> audioSamples; // samples on their way from the apu to the audio ring
+
+    // shared between the threads
+
+    std::unique_ptr<TripleBuffer<VideoFrame>> frames;
+
+    SpscQueue<Command, 256> commands;
+
+    std::atomic<bool> quit{false};
+
+    std::thread emulationThread;
+
+    AudioRing audio; // filled by the emulation thread, drained by the audio device callback
+
+    TraceRing trace; // recorded by the emulation thread, dumped by the UI thread or on a crash
+
+    // owned by the UI thread
+
+    u8 heldButtons = 0;
+
+    DebugOverlay overlay;
+    bool showOverlay = true;
+
+    void emulation_loop();
+
+    /// apply a command on the emulation thread, returns true if it changed what is on screen
+    bool execute(const Command &command);
+
+    /// hand the current state to the UI thread
+    void publish_frame(double frameCost);
+
+    /// move the apu's samples to the audio ring and steer its rate by how full the ring is
+    void queue_audio();
 
     void draw();
 
     void handle_events();
+
+    void update_input();
+
+    /// queue a command for the emulation thread, returns false if the queue is full
+    bool send(CommandType type, u32 value = 0);
 };
 
 } // namespace nes
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <array>
+#include <string>
+
+#include "common/types.hpp"
+#include "nes/cpu.hpp"
+
+namespace nes {
+
+/// One instruction as it was about to execute, i.e. what a line of a nestest style log shows
+struct TraceEntry {
+    u16 PC;
+    std::array<u8, 3> bytes; // opcode and operand bytes, see OPERAND_LENGTH_LOOKUP for how many
+    u8 A, X, Y, P, SP;
+    u64 cycle; // cycles executed before this instruction
+};
+
+/// capture the instruction at the cpu's PC, without side effects on the bus
+TraceEntry capture_trace(const Cpu &cpu);
+
+/// format an entry the way nestest.log does, without the PPU column and the "= value" notes:
+/// "C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD CYC:7"
+std::string format_trace(const TraceEntry &entry);
+
+} // namespace nes
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/types.hpp"
+#include "nes/cpu.hpp"
+#include "nes/trace.hpp"
+
+namespace nes {
+
+/// bumped whenever the layout of a trace dump changes
+static constexpr u32 TRACE_DUMP_VERSION = 1;
+
+/// One executed instruction, as it was about to execute. Fixed size so recording is a handful of
+/// stores, decode offline with to_trace_entry()
+struct TraceRecord {
+    u32 cycleLow;  // cycles executed before the instruction, low and high part of 48 bits
+    u16 cycleHigh;
+    u16 PC;
+    std::array<u8, 3> bytes; // opcode and operand bytes
+    u8 A, X, Y, P, SP;
+};
+
+static_assert(sizeof(TraceRecord) == 16, "trace records are meant to be 16 bytes");
+
+/// Start of a trace dump file, followed by count records, oldest first
+struct TraceDumpHeader {
+    std::array<char, 4> magic; // "NEST"
+    u32 version;
+    u64 count;
+};
+
+/// A ring of the last N instructions the cpu executed, for finding out how a session ended up
+/// hung or crashed.
+///
+/// The cpu records into it while Cpu::trace points at it, which costs one predictable branch
+/// per instruction while tracing is off. There is a single writer (the emulation thread) and it
+/// never waits; readers take a snapshot() from any thread while the cpu runs, or dump() it to a
+/// file, and dump_on_crash() writes it from a signal handler. Dumps are turned into text by
+/// nes_trace_decode.
+class TraceRing {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 64 * 1024; // records, 1 MiB
+
+    /// capacity is rounded up to a power of two
+    explicit TraceRing(size_t capacity = DEFAULT_CAPACITY);
+    ~TraceRing();
+
+    TraceRing(const TraceRing &)            = delete;
+    TraceRing &operator=(const TraceRing &) = delete;
+
+    /// called by the cpu before executing an instruction. PC and the registers are taken from
+    /// the arguments, the cpu's own PC already points past the instruction
+    inline void record(const Cpu &cpu, u16 pc, u8 opcode, u16 operand) {
+        u64 index = head.load(std::memory_order_relaxed);
+
+        TraceRecord &r = records[index & mask];
+        r.cycleLow     = (u32) cpu.cyclesExecuted;
+        r.cycleHigh    = (u16) (cpu.cyclesExecuted >> 32);
+        r.PC           = pc;
+        r.bytes        = {opcode, (u8) operand, (u8) (operand >> 8)};
+        r.A            = cpu.A;
+        r.X            = cpu.X;
+        r.Y            = cpu.Y;
+        r.P            = cpu.P;
+        r.SP           = cpu.SP;
+
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    /// copy the records currently held, oldest first. safe while the cpu is recording, records
+    /// overwritten during the copy are left out
+    void snapshot(std::vector<TraceRecord> &out) const;
+
+    /// write a snapshot to a file
+    bool dump(const std::string &filepath) const;
+
+    /// dump to the given file if the process dies of SIGSEGV, SIGBUS, SIGILL, SIGFPE or SIGABRT.
+    /// one ring at a time, a nullptr path stops it
+    void dump_on_crash(const char *filepath);
+
+    /// instructions recorded since the ring was created or cleared
+    inline u64 get_count() const {
+        return head.load(std::memory_order_acquire);
+    }
+
+    inline size_t get_capacity() const {
+        return mask + 1;
+    }
+
+    /// forget all records. only while the cpu isn't recording
+    inline void clear() {
+        head.store(0, std::memory_order_release);
+    }
+
+private:
+    std::unique_ptr<TraceRecord[]> records;
+    size_t mask;
+
+    alignas(64) std::atomic<u64> head{0}; // records written so far
+
+    static void on_crash(int signal);
+};
+
+/// read a file written by TraceRing::dump()
+bool read_trace_dump(const std::string &filepath, std::vector<TraceRecord> &records);
+
+/// expand a record for format_trace()
+inline TraceEntry to_trace_entry(const TraceRecord &record) {
+    return {record.PC,
+            record.bytes,
+            record.A,
+            record.X,
+            record.Y,
+            record.P,
+            record.SP,
+            ((u64) record.cycleHigh << 32) | record.cycleLow};
+}
+
+} // namespace nes
@@ -0,0 +1,719 @@
+#include "nes/apu.hpp"
+#include "nes/bus.hpp"
+#include "nes/core.hpp"
+
+#include <algorithm>
+
+using namespace nes;
+
+//
+
+static constexpr u8 LENGTH_TABLE[32] = {
+    10, 254, 20, 2,  40, 4,  80, 6,  160, 8,  60, 10, 14, 12, 26, 14,
+    12, 16,  24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30,
+};
+
+static constexpr u8 DUTY_TABLE[4][8] = {
+    {0, 1, 0, 0, 0, 0, 0, 0},
+    {0, 1, 1, 0, 0, 0, 0, 0},
+    {0, 1, 1, 1, 1, 0, 0, 0},
+    {1, 0, 0, 1, 1, 1, 1, 1},
+};
+
+static constexpr u8 TRIANGLE_TABLE[32] = {
+    15, 14, 13, 12, 11, 10, 9,  8,  7,  6,  5,  4,  3,  2,  1,  0,
+    0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15,
+};
+
+/// NTSC timer periods, in cpu cycles
+static constexpr u16 NOISE_PERIODS[16] = {
+    4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068,
+};
+
+static constexpr u16 DMC_PERIODS[16] = {
+    428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54,
+};
+
+/// frame counter steps, in cpu cycles from the start of the sequence, and the sequence lengths
+static constexpr u32 FOUR_STEP_SEQUENCE[4] = {7457, 14913, 22371, 29829};
+static constexpr u32 FIVE_STEP_SEQUENCE[5] = {7457, 14913, 22371, 29829, 37281};
+static constexpr u32 FOUR_STEP_PERIOD      = 29830;
+static constexpr u32 FIVE_STEP_PERIOD      = 37282;
+
+/// linear approximation of the mixer, output per level step of each channel
+static constexpr float PULSE_WEIGHT    = 0.00752f * Apu::MASTER_VOLUME;
+static constexpr float TRIANGLE_WEIGHT = 0.00851f * Apu::MASTER_VOLUME;
+static constexpr float NOISE_WEIGHT    = 0.00494f * Apu::MASTER_VOLUME;
+static constexpr float DMC_WEIGHT      = 0.00335f * Apu::MASTER_VOLUME;
+
+/// longest stretch fed to the sample buffer as one frame, keeps frame times in 32 bits and
+/// frames well within the buffer when the cpu runs far without ending a frame
+static constexpr u64 MAX_FRAME_CYCLES = CPU_CLOCK_RATE_HZ / 16;
+
+/// cpu cycles a DMC sample fetch steals. 4 is the usual case, it is 3 when it lands on a write
+/// cycle and more when it collides with OAM DMA, which isn't modelled
+static constexpr u32 DMC_DMA_CYCLES = 4;
+
+/// how much output the sample buffer holds before the oldest samples are dropped
+static constexpr double BUFFER_SECONDS = 0.25;
+
+enum ChannelBit : u8 {
+    ch_PULSE1   = 1 << 0,
+    ch_PULSE2   = 1 << 1,
+    ch_TRIANGLE = 1 << 2,
+    ch_NOISE    = 1 << 3,
+    ch_DMC      = 1 << 4,
+};
+
+//
+
+static inline void clock_envelope(Apu::Envelope &e, bool loop, u8 period) {
+    if (e.start) {
+        e.start   = false;
+        e.decay   = 15;
+        e.divider = period;
+    } else if (e.divider == 0) {
+        e.divider = period;
+        if (e.decay > 0) {
+            e.decay--;
+        } else if (loop) {
+            e.decay = 15;
+        }
+    } else {
+        e.divider--;
+    }
+}
+
+/// period the sweep unit would switch to. pulse 1 negates in ones' complement
+static inline u16 sweep_target(const Apu::Pulse &p, bool ones) {
+    u16 change = p.period >> p.sweepShift;
+    if (p.sweepNegate) {
+        return p.period - change - (ones ? 1 : 0);
+    }
+    return p.period + change;
+}
+
+/// the sweep unit silences the channel whether it is enabled or not
+static inline bool sweep_mutes(const Apu::Pulse &p, bool ones) {
+    return p.period < 8 || (!p.sweepNegate && sweep_target(p, ones) > 0x7FF);
+}
+
+/// feed a change of a channel's level to the buffer
+static inline void set_level(BlipBuffer *out, u8 &output, u8 level, u32 time, float weight) {
+    if (level != output) {
+        if (out != nullptr) {
+            out->add_delta(time, (float) (level - output) * weight);
+        }
+        output = level;
+    }
+}
+
+/// the noise shift register is linear over GF(2), so any number of clocks is a matrix. one
+/// matrix per power of two clocks and mode, each as the images of the 15 single bit states
+using LfsrJump = std::array<u16, 15>;
+using LfsrJumps = std::array<std::array<LfsrJump, 32>, 2>;
+
+static u16 clock_lfsr(u16 shift, u32 tap) {
+    u16 feedback = (shift ^ (shift >> tap)) & 1;
+    return (u16) ((shift >> 1) | (feedback << 14));
+}
+
+static u16 apply_jump(const LfsrJump &jump, u16 shift) {
+    u16 result = 0;
+    for (u32 bit = 0; shift != 0; bit++, shift >>= 1) {
+        result ^= (shift & 1) ? jump[bit] : 0;
+    }
+    return result;
+}
+
+static LfsrJumps make_lfsr_jumps() {
+    LfsrJumps jumps;
+    for (u32 mode = 0; mode < 2; mode++) {
+        for (u32 bit = 0; bit < 15; bit++) {
+            jumps[mode][0][bit] = clock_lfsr((u16) (1 << bit), mode ? 6 : 1);
+        }
+        for (u32 power = 1; power < 32; power++) {
+            for (u32 bit = 0; bit < 15; bit++) {
+                const auto &half        = jumps[mode][power - 1];
+                jumps[mode][power][bit] = apply_jump(half, half[bit]);
+            }
+        }
+    }
+    return jumps;
+}
+
+static const LfsrJumps LFSR_JUMPS = make_lfsr_jumps();
+
+/// the shift register after the given number of clocks, without stepping through them
+static u16 advance_lfsr(u16 shift, u32 clocks, bool mode) {
+    for (u32 power = 0; clocks != 0; power++, clocks >>= 1) {
+        if (clocks & 1) {
+            shift = apply_jump(LFSR_JUMPS[mode][power], shift);
+        }
+    }
+    return shift;
+}
+
+/// number of timer clocks from time up to end
+static inline u32 clocks_until(u32 time, u32 end, u32 period) {
+    return (end - time + period - 1) / period;
+}
+
+//
+
+Apu::Apu() {
+    noise.shift  = 1;
+    dmc.bitsLeft = 8;
+    dmc.silence  = true;
+}
+
+void Apu::save_state(State &state) const {
+    state.pulse         = pulse;
+    state.triangle      = triangle;
+    state.noise         = noise;
+    state.dmc           = dmc;
+    state.enabled       = enabled;
+    state.fiveStep      = fiveStep;
+    state.irqInhibit    = irqInhibit;
+    state.frameIrq      = frameIrq;
+    state.dmcIrq        = dmcIrq;
+    state.frameStep     = frameStep;
+    state.sequenceStart = sequenceStart;
+    state.cycle         = cycle;
+    state.frameStart    = frameStart;
+}
+
+void Apu::load_state(const State &state) {
+    pulse         = state.pulse;
+    triangle      = state.triangle;
+    noise         = state.noise;
+    dmc           = state.dmc;
+    enabled       = state.enabled;
+    fiveStep      = state.fiveStep;
+    irqInhibit    = state.irqInhibit;
+    frameIrq      = state.frameIrq;
+    dmcIrq        = state.dmcIrq;
+    frameStep     = state.frameStep;
+    sequenceStart = state.sequenceStart;
+    cycle         = state.cycle;
+    frameStart    = state.frameStart;
+
+    // the irq lines are cpu state, restored with it
+}
+
+void Apu::attach(Cpu *c, Bus *b, Scheduler *s) {
+    cpu       = c;
+    bus       = b;
+    scheduler = s;
+
+    scheduler->set_handler(ev_APU_FRAME_COUNTER, on_frame_counter, this);
+    scheduler->set_handler(ev_DMA, on_dmc_fetch, this);
+}
+
+void Apu::reset() {
+    pulse    = {};
+    triangle = {};
+    noise    = {};
+    dmc      = {};
+
+    noise.shift       = 1;
+    dmc.bitsLeft      = 8;
+    dmc.silence       = true;
+    dmc.sampleAddress = 0xC000;
+    dmc.sampleLength  = 1;
+
+    enabled    = 0;
+    fiveStep   = false;
+    irqInhibit = false;
+    frameIrq   = false;
+    dmcIrq     = false;
+    update_irq();
+
+    cycle      = cpu->cyclesExecuted;
+    frameStart = cycle;
+    restart_sequence(cycle);
+    scheduler->cancel(ev_DMA);
+}
+
+//
+
+void Apu::write_register(u16 address, u8 data) {
+    // everything before the write still plays with the old settings
+    run_until(cpu->cyclesExecuted);
+
+    switch (address) {
+    case 0x4000:
+    case 0x4004: {
+        Pulse &p   = pulse[(address - 0x4000) >> 2];
+        p.duty     = data >> 6;
+        p.halt     = (data & 0x20) != 0;
+        p.constant = (data & 0x10) != 0;
+        p.volume   = data & 0x0F;
+        break;
+    }
+    case 0x4001:
+    case 0x4005: {
+        Pulse &p       = pulse[(address - 0x4000) >> 2];
+        p.sweepEnabled = (data & 0x80) != 0;
+        p.sweepPeriod  = (data >> 4) & 0x07;
+        p.sweepNegate  = (data & 0x08) != 0;
+        p.sweepShift   = data & 0x07;
+        p.sweepReload  = true;
+        break;
+    }
+    case 0x4002:
+    case 0x4006: {
+        Pulse &p = pulse[(address - 0x4000) >> 2];
+        p.period = (p.period & 0x700) | data;
+        break;
+    }
+    case 0x4003:
+    case 0x4007: {
+        u32 index = (address - 0x4000) >> 2;
+        Pulse &p  = pulse[index];
+        p.period  = (p.period & 0xFF) | ((data & 0x07) << 8);
+        if (enabled & (ch_PULSE1 << index)) {
+            p.length = LENGTH_TABLE[data >> 3];
+        }
+        p.step           = 0;
+        p.envelope.start = true;
+        break;
+    }
+    case 0x4008:
+        triangle.control    = (data & 0x80) != 0;
+        triangle.linearLoad = data & 0x7F;
+        break;
+    case 0x400A:
+        triangle.period = (triangle.period & 0x700) | data;
+        break;
+    case 0x400B:
+        triangle.period = (triangle.period & 0xFF) | ((data & 0x07) << 8);
+        if (enabled & ch_TRIANGLE) {
+            triangle.length = LENGTH_TABLE[data >> 3];
+        }
+        triangle.linearReload = true;
+        break;
+    case 0x400C:
+        noise.halt     = (data & 0x20) != 0;
+        noise.constant = (data & 0x10) != 0;
+        noise.volume   = data & 0x0F;
+        break;
+    case 0x400E:
+        noise.mode        = (data & 0x80) != 0;
+        noise.periodIndex = data & 0x0F;
+        break;
+    case 0x400F:
+        if (enabled & ch_NOISE) {
+            noise.length = LENGTH_TABLE[data >> 3];
+        }
+        noise.envelope.start = true;
+        break;
+    case 0x4010:
+        dmc.irqEnabled = (data & 0x80) != 0;
+        dmc.loop       = (data & 0x40) != 0;
+        dmc.rateIndex  = data & 0x0F;
+        if (!dmc.irqEnabled) {
+            dmcIrq = false;
+            update_irq();
+        }
+        schedule_dmc_fetch();
+        break;
+    case 0x4011:
+        // heard from the next run on, which starts right here
+        dmc.level = data & 0x7F;
+        break;
+    case 0x4012:
+        dmc.sampleAddress = 0xC000 + (data << 6);
+        break;
+    case 0x4013:
+        dmc.sampleLength = (data << 4) + 1;
+        break;
+    case 0x4015:
+        enabled = data & 0x1F;
+        if (!(enabled & ch_PULSE1)) {
+            pulse[0].length = 0;
+        }
+        if (!(enabled & ch_PULSE2)) {
+            pulse[1].length = 0;
+        }
+        if (!(enabled & ch_TRIANGLE)) {
+            triangle.length = 0;
+        }
+        if (!(enabled & ch_NOISE)) {
+            noise.length = 0;
+        }
+        if (!(enabled & ch_DMC)) {
+            dmc.remaining = 0;
+        } else if (dmc.remaining == 0) {
+            dmc.address   = dmc.sampleAddress;
+            dmc.remaining = dmc.sampleLength;
+            fetch_dmc_sample();
+        }
+        dmcIrq = false;
+        update_irq();
+        schedule_dmc_fetch();
+        break;
+    case 0x4017:
+        fiveStep   = (data & 0x80) != 0;
+        irqInhibit = (data & 0x40) != 0;
+        if (irqInhibit) {
+            frameIrq = false;
+            update_irq();
+        }
+        // the sequencer restarts a few cycles after the write, the 5 step mode clocks
+        // everything right away
+        restart_sequence(cycle + 3);
+        if (fiveStep) {
+            clock_quarter_frame();
+            clock_half_frame();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+u8 Apu::read_status() {
+    run_until(cpu->cyclesExecuted);
+
+    u8 status = (pulse[0].length > 0 ? 0x01 : 0) | (pulse[1].length > 0 ? 0x02 : 0) |
+                (triangle.length > 0 ? 0x04 : 0) | (noise.length > 0 ? 0x08 : 0) |
+                (dmc.remaining > 0 ? 0x10 : 0) | (frameIrq ? 0x40 : 0) | (dmcIrq ? 0x80 : 0);
+
+    // reading acknowledges the frame interrupt, not the DMC one
+    frameIrq = false;
+    update_irq();
+
+    return status;
+}
+
+//
+
+void Apu::end_frame() {
+    run_until(cpu->cyclesExecuted);
+    end_buffer_frame(cycle);
+}
+
+void Apu::set_sample_rate(u32 rate) {
+    sampleRate = rate;
+    if (rate != 0) {
+        blip = BlipBuffer((size_t) (rate * BUFFER_SECONDS));
+        blip.set_rates((double) CPU_CLOCK_RATE_HZ, rate);
+    } else {
+        blip = BlipBuffer();
+    }
+    frameStart = cycle;
+}
+
+void Apu::run_until(u64 target) {
+    if (target <= cycle) {
+        return;
+    }
+
+    while (target - frameStart > MAX_FRAME_CYCLES) {
+        u64 split = frameStart + MAX_FRAME_CYCLES;
+        run_channels(split);
+        end_buffer_frame(split);
+    }
+    run_channels(target);
+}
+
+void Apu::run_channels(u64 target) {
+    u32 start = (u32) (cycle - frameStart);
+    u32 end   = (u32) (target - frameStart);
+
+    run_pulse(pulse[0], true, start, end);
+    run_pulse(pulse[1], false, start, end);
+    run_triangle(start, end);
+    run_noise(start, end);
+    run_dmc(start, end);
+
+    cycle = target;
+}
+
+void Apu::end_buffer_frame(u64 end) {
+    u32 duration = (u32) (end - frameStart);
+    frameStart   = end;
+
+    if (sink() == nullptr) {
+        return;
+    }
+
+    blip.end_frame(duration);
+    reserve_buffer_frame();
+}
+
+void Apu::reserve_buffer_frame() {
+    if (sampleRate == 0) {
+        return;
+    }
+
+    // the channels write the next frame's level changes as they happen, up to MAX_FRAME_CYCLES
+    // past the readable samples. if nobody is reading, drop the oldest samples now so a whole
+    // frame always fits
+    size_t needed    = blip.samples_for(MAX_FRAME_CYCLES);
+    size_t available = blip.samples_available();
+    if (available + needed > blip.get_capacity()) {
+        size_t drop = available + needed - blip.get_capacity();
+        blip.remove_samples(drop);
+        droppedSamples += drop;
+    }
+}
+
+//
+
+void Apu::run_pulse(Pulse &p, bool ones, u32 start, u32 end) {
+    BlipBuffer *out = sink();
+
+    u8 volume = p.length > 0 && !sweep_mutes(p, ones)
+                    ? (p.constant ? p.volume : p.envelope.decay)
+                    : 0;
+    const u8 *duty = DUTY_TABLE[p.duty];
+    set_level(out, p.output, duty[p.step] ? volume : 0, start, PULSE_WEIGHT);
+
+    u32 period = (p.period + 1) * 2;
+    u32 time   = start + p.delay;
+    if (time < end) {
+        if (volume == 0 || out == nullptr) {
+            // nothing to hear, only the sequencer position matters
+            u32 clocks = clocks_until(time, end, period);
+            p.step     = (p.step + clocks) & 0x07;
+            time += clocks * period;
+            set_level(out, p.output, duty[p.step] ? volume : 0, time - period, PULSE_WEIGHT);
+        } else {
+            for (; time < end; time += period) {
+                p.step = (p.step + 1) & 0x07;
+                set_level(out, p.output, duty[p.step] ? volume : 0, time, PULSE_WEIGHT);
+            }
+        }
+    }
+    p.delay = time - end;
+}
+
+void Apu::run_triangle(u32 start, u32 end) {
+    BlipBuffer *out = sink();
+    Triangle &t     = triangle;
+
+    set_level(out, t.output, TRIANGLE_TABLE[t.step], start, TRIANGLE_WEIGHT);
+
+    u32 period = t.period + 1;
+    u32 time   = start + t.delay;
+    if (time < end) {
+        // the sequencer holds its position while halted. ultrasonic periods are held too, games
+        // use them to silence the channel and stepping at 900 kHz would only be heard as noise
+        if (t.length == 0 || t.linear == 0 || t.period < 2) {
+            time += clocks_until(time, end, period) * period;
+        } else if (out == nullptr) {
+            u32 clocks = clocks_until(time, end, period);
+            t.step     = (t.step + clocks) & 0x1F;
+            t.output   = TRIANGLE_TABLE[t.step];
+            time += clocks * period;
+        } else {
+            for (; time < end; time += period) {
+                t.step = (t.step + 1) & 0x1F;
+                set_level(out, t.output, TRIANGLE_TABLE[t.step], time, TRIANGLE_WEIGHT);
+            }
+        }
+    }
+    t.delay = time - end;
+}
+
+void Apu::run_noise(u32 start, u32 end) {
+    BlipBuffer *out = sink();
+    Noise &n        = noise;
+
+    u8 volume = n.length > 0 ? (n.constant ? n.volume : n.envelope.decay) : 0;
+    set_level(out, n.output, (n.shift & 1) ? 0 : volume, start, NOISE_WEIGHT);
+
+    u32 period = NOISE_PERIODS[n.periodIndex];
+    u32 tap    = n.mode ? 6 : 1;
+    u32 time   = start + n.delay;
+    if (time < end && (volume == 0 || out == nullptr)) {
+        // nothing to hear, jump the shift register over the whole stretch
+        u32 clocks = clocks_until(time, end, period);
+        n.shift    = advance_lfsr(n.shift, clocks, n.mode);
+        time += clocks * period;
+        set_level(out, n.output, (n.shift & 1) ? 0 : volume, time - period, NOISE_WEIGHT);
+    }
+    for (; time < end; time += period) {
+        n.shift = clock_lfsr(n.shift, tap);
+        set_level(out, n.output, (n.shift & 1) ? 0 : volume, time, NOISE_WEIGHT);
+    }
+    n.delay = time - end;
+}
+
+void Apu::run_dmc(u32 start, u32 end) {
+    BlipBuffer *out = sink();
+    Dmc &d          = dmc;
+
+    set_level(out, d.output, d.level, start, DMC_WEIGHT);
+
+    u32 period = DMC_PERIODS[d.rateIndex];
+    u32 time   = start + d.delay;
+    if (time < end && d.silence && !d.bufferFull && d.remaining == 0) {
+        // idle, the output cycles just keep counting down
+        u32 clocks = clocks_until(time, end, period);
+        d.bitsLeft = (u8) (((d.bitsLeft - 1) + 8 - clocks % 8) % 8 + 1);
+        time += clocks * period;
+    }
+    for (; time < end; time += period) {
+        if (!d.silence) {
+            if (d.shift & 1) {
+                d.level += d.level <= 125 ? 2 : 0;
+            } else {
+                d.level -= d.level >= 2 ? 2 : 0;
+            }
+            set_level(out, d.output, d.level, time, DMC_WEIGHT);
+        }
+        d.shift >>= 1;
+
+        if (--d.bitsLeft == 0) {
+            d.bitsLeft = 8;
+            d.silence  = !d.bufferFull;
+            if (d.bufferFull) {
+                d.shift      = d.buffer;
+                d.bufferFull = false;
+                fetch_dmc_sample();
+            }
+        }
+    }
+    d.delay = time - end;
+}
+
+void Apu::fetch_dmc_sample() {
+    Dmc &d = dmc;
+    if (d.bufferFull || d.remaining == 0) {
+        return;
+    }
+
+    d.buffer     = bus->read_u8(d.address);
+    d.bufferFull = true;
+    cpu->stall(DMC_DMA_CYCLES);
+    d.address    = d.address == 0xFFFF ? 0x8000 : d.address + 1;
+
+    if (--d.remaining == 0) {
+        if (d.loop) {
+            d.address   = d.sampleAddress;
+            d.remaining = d.sampleLength;
+        } else if (d.irqEnabled) {
+            dmcIrq = true;
+            update_irq();
+        }
+    }
+}
+
+//
+
+void Apu::clock_quarter_frame() {
+    clock_envelope(pulse[0].envelope, pulse[0].halt, pulse[0].volume);
+    clock_envelope(pulse[1].envelope, pulse[1].halt, pulse[1].volume);
+    clock_envelope(noise.envelope, noise.halt, noise.volume);
+
+    if (triangle.linearReload) {
+        triangle.linear = triangle.linearLoad;
+    } else if (triangle.linear > 0) {
+        triangle.linear--;
+    }
+    if (!triangle.control) {
+        triangle.linearReload = false;
+    }
+}
+
+void Apu::clock_half_frame() {
+    for (u32 i = 0; i < 2; i++) {
+        Pulse &p = pulse[i];
+        if (!p.halt && p.length > 0) {
+            p.length--;
+        }
+
+        bool ones = i == 0;
+        if (p.sweepDivider == 0 && p.sweepEnabled && p.sweepShift > 0 && !sweep_mutes(p, ones)) {
+            p.period = sweep_target(p, ones);
+        }
+        if (p.sweepDivider == 0 || p.sweepReload) {
+            p.sweepDivider = p.sweepPeriod;
+            p.sweepReload  = false;
+        } else {
+            p.sweepDivider--;
+        }
+    }
+
+    if (!triangle.control && triangle.length > 0) {
+        triangle.length--;
+    }
+    if (!noise.halt && noise.length > 0) {
+        noise.length--;
+    }
+}
+
+void Apu::update_irq() {
+    cpu->set_irq_line(irq_APU_FRAME, frameIrq);
+    cpu->set_irq_line(irq_DMC, dmcIrq);
+}
+
+//
+
+void Apu::restart_sequence(u64 start) {
+    sequenceStart = start;
+    frameStep     = 0;
+    schedule_frame_step();
+}
+
+void Apu::schedule_frame_step() {
+    u32 offset = fiveStep ? FIVE_STEP_SEQUENCE[frameStep] : FOUR_STEP_SEQUENCE[frameStep];
+    scheduler->schedule(ev_APU_FRAME_COUNTER,
+                        (sequenceStart + offset) * Scheduler::MASTER_CYCLES_PER_CPU_CYCLE);
+}
+
+void Apu::schedule_dmc_fetch() {
+    const Dmc &d = dmc;
+    if (!d.bufferFull || d.remaining == 0) {
+        scheduler->cancel(ev_DMA);
+        return;
+    }
+
+    // the next byte is fetched when the output unit takes the current one out of the buffer, on
+    // the timer clock ending its output cycle. catching up past that clock is what runs it, so
+    // the event is due the cycle after. the fetch then stalls the cpu and raises the interrupt
+    // after the last byte right there, rather than whenever something else next runs the apu
+    u64 cycles = d.delay + (u64) (d.bitsLeft - 1) * DMC_PERIODS[d.rateIndex];
+    scheduler->schedule(ev_DMA, (cycle + cycles + 1) * Scheduler::MASTER_CYCLES_PER_CPU_CYCLE);
+}
+
+void Apu::on_frame_counter(void *context, u64 timestamp) {
+    auto apu = static_cast<Apu *>(context);
+    apu->run_until(timestamp / Scheduler::MASTER_CYCLES_PER_CPU_CYCLE);
+
+    u8 step = apu->frameStep;
+    if (apu->fiveStep) {
+        // steps 0 and 2 clock quarter frames, 1 and 4 both, 3 nothing
+        if (step != 3) {
+            apu->clock_quarter_frame();
+        }
+        if (step == 1 || step == 4) {
+            apu->clock_half_frame();
+        }
+    } else {
+        apu->clock_quarter_frame();
+        if (step == 1 || step == 3) {
+            apu->clock_half_frame();
+        }
+        if (step == 3 && !apu->irqInhibit) {
+            apu->frameIrq = true;
+            apu->update_irq();
+        }
+    }
+
+    u32 steps = apu->fiveStep ? 5 : 4;
+    if (++apu->frameStep == steps) {
+        apu->sequenceStart += apu->fiveStep ? FIVE_STEP_PERIOD : FOUR_STEP_PERIOD;
+        apu->frameStep = 0;
+    }
+    apu->schedule_frame_step();
+}
+
+void Apu::on_dmc_fetch(void *context, u64 timestamp) {
+    auto apu = static_cast<Apu *>(context);
+    apu->run_until(timestamp / Scheduler::MASTER_CYCLES_PER_CPU_CYCLE);
+    apu->schedule_dmc_fetch();
+}
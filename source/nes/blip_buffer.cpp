@@ -0,0 +1,113 @@
+#include "nes/blip_buffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace nes;
+
+//
+
+/// cutoff of the impulses relative to the output Nyquist frequency, a little below it so the
+/// short kernel still attenuates what would alias
+static constexpr double CUTOFF = 0.9;
+
+/// corner of the output high-pass, the NES itself has one at 37 Hz
+static constexpr double HIGH_PASS_HZ = 37.0;
+
+static constexpr double PI = 3.14159265358979323846;
+
+static std::array<std::array<float, BlipBuffer::TAPS>, BlipBuffer::PHASES> make_kernels() {
+    constexpr u32 TAPS = BlipBuffer::TAPS;
+
+    std::array<std::array<float, TAPS>, BlipBuffer::PHASES> kernels = {};
+    for (u32 phase = 0; phase < BlipBuffer::PHASES; phase++) {
+        double offset = (double) phase / BlipBuffer::PHASES;
+
+        double values[TAPS];
+        double sum = 0.0;
+        for (u32 i = 0; i < TAPS; i++) {
+            // distance of the tap from the step, in output samples. the impulse is delayed by
+            // half its width so it only ever reaches forward
+            double t    = i - (TAPS / 2 - 1) - offset;
+            double x    = PI * CUTOFF * t;
+            double sinc = x == 0.0 ? 1.0 : std::sin(x) / x;
+
+            // blackman window over (-TAPS / 2, TAPS / 2)
+            double w      = (t + TAPS / 2) / TAPS;
+            double window = 0.42 - 0.5 * std::cos(2 * PI * w) + 0.08 * std::cos(4 * PI * w);
+
+            values[i] = sinc * window;
+            sum += values[i];
+        }
+        for (u32 i = 0; i < TAPS; i++) {
+            kernels[phase][i] = (float) (values[i] / sum);
+        }
+    }
+    return kernels;
+}
+
+const std::array<BlipBuffer::Kernel, BlipBuffer::PHASES> BlipBuffer::KERNELS = make_kernels();
+
+//
+
+BlipBuffer::BlipBuffer(size_t capacity) : samples(capacity + TAPS), capacity(capacity) {}
+
+void BlipBuffer::set_rates(double clockRate, double sampleRate) {
+    baseFactor = (u64) (sampleRate / clockRate * (double) (1ULL << FRAC_BITS) + 0.5);
+    factor     = baseFactor;
+    leak       = (float) (1.0 - std::exp(-2.0 * PI * HIGH_PASS_HZ / sampleRate));
+    clear();
+}
+
+void BlipBuffer::clear() {
+    std::fill(samples.begin(), samples.end(), 0.0f);
+    offset     = 0;
+    integrator = 0.0f;
+}
+
+void BlipBuffer::end_frame(u32 duration) {
+    offset += duration * factor;
+}
+
+size_t BlipBuffer::read_samples(int16_t *out, size_t count) {
+    count = std::min(count, samples_available());
+
+    float level = integrator;
+    for (size_t i = 0; i < count; i++) {
+        level += samples[i];
+        out[i] = (int16_t) std::clamp(level, -32768.0f, 32767.0f);
+        level -= level * leak;
+    }
+    integrator = level;
+
+    shift_out(count);
+    return count;
+}
+
+void BlipBuffer::remove_samples(size_t count) {
+    count = std::min(count, samples_available());
+
+    // the level still has to follow the dropped steps
+    float level = integrator;
+    for (size_t i = 0; i < count; i++) {
+        level += samples[i];
+        level -= level * leak;
+    }
+    integrator = level;
+
+    shift_out(count);
+}
+
+void BlipBuffer::shift_out(size_t count) {
+    if (count == 0) {
+        return;
+    }
+
+    // what is left, including the impulse tails reaching past the readable samples
+    size_t remaining = samples_available() + TAPS - count;
+    std::memmove(samples.data(), samples.data() + count, remaining * sizeof(float));
+    std::fill(samples.begin() + remaining, samples.begin() + remaining + count, 0.0f);
+
+    offset -= (u64) count << FRAC_BITS;
+}
@@ -0,0 +1,230 @@
+#include "nes/block_cache.hpp"
+#include "nes/profiler.hpp"
+#include "nes/trace_ring.hpp"
+
+using namespace nes;
+
+//
+
+/// instructions that (may) change the PC end a block
+static constexpr bool ends_block(OperationType op) {
+    switch (op) {
+    case op_BCC: case op_BCS: case op_BEQ: case op_BMI: case op_BNE: case op_BPL: case op_BVC:
+    case op_BVS: case op_BRK: case op_JMP: case op_JSR: case op_RTI: case op_RTS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+//
+
+void BlockCache::attach(Cpu *c, Bus *b) {
+    cpu = c;
+    bus = b;
+}
+
+u64 BlockCache::run(u64 cycles) {
+    u64 start = cpu->cyclesExecuted;
+    target    = start + cycles;
+
+    // picked once per batch, so without a trace or profiler the loop has nothing to check
+    if (cpu->trace != nullptr || cpu->profiler != nullptr) {
+        run_blocks<true>();
+    } else {
+        run_blocks<false>();
+    }
+
+    return cpu->cyclesExecuted - start;
+}
+
+template <bool Instrumented>
+void BlockCache::run_blocks() {
+    TraceRing *trace   = cpu->trace;
+    Profiler *profiler = cpu->profiler;
+
+    while (cpu->cyclesExecuted < target) {
+        cpu->poll_irq();
+
+        const Block *block = lookup();
+        if (block == nullptr) {
+            // not backed by host memory (or split across pages), step it the slow way
+            if constexpr (Instrumented) {
+                u16 pc     = cpu->PC;
+                u8 opcode  = bus->peek_u8(pc);
+                u64 before = cpu->cyclesExecuted;
+                cpu->clock();
+                if (profiler != nullptr) {
+                    profiler->record(pc, opcode, cpu->cyclesExecuted - before, cpu->PC);
+                }
+            } else {
+                cpu->clock();
+            }
+            continue;
+        }
+
+        u64 blockGeneration = generation;
+        for (u32 i = 0; i < block->count; i++) {
+            const auto &ins = block->instructions[i];
+            if constexpr (Instrumented) {
+                u16 pc     = cpu->PC;
+                u64 before = cpu->cyclesExecuted;
+                if (trace != nullptr) {
+                    trace->record(*cpu, pc, ins.opcode, ins.operand);
+                }
+                ins.handler(*cpu, ins.operand);
+                if (profiler != nullptr) {
+                    profiler->record(pc, ins.opcode, cpu->cyclesExecuted - before, cpu->PC);
+                }
+            } else {
+                ins.handler(*cpu, ins.operand);
+            }
+
+            if (cpu->cyclesExecuted >= target || generation != blockGeneration) {
+                break;
+            }
+        }
+    }
+}
+
+void BlockCache::invalidate_all() {
+    for (u32 page = 0; page < Bus::PAGE_COUNT; page++) {
+        if (traps[page].write != nullptr) {
+            remove_trap(page);
+        }
+    }
+
+    for (auto &block : blocks) {
+        block.page = nullptr;
+    }
+
+    generation++;
+}
+
+void BlockCache::invalidate_writable() {
+    for (u32 page = 0; page < Bus::PAGE_COUNT; page++) {
+        if (traps[page].write != nullptr) {
+            unprotect_writes(traps[page].write);
+        }
+    }
+}
+
+//
+
+const BlockCache::Block *BlockCache::lookup() {
+    u16 pc         = cpu->PC;
+    const u8 *page = bus->get_read_page(pc >> 8);
+    if (page == nullptr) {
+        return nullptr;
+    }
+
+    Block &block = blocks[pc & (BLOCK_COUNT - 1)];
+    if (block.page == page && block.pc == pc) {
+        hits++;
+        return &block;
+    }
+
+    misses++;
+    return decode(block, pc, page) ? &block : nullptr;
+}
+
+bool BlockCache::decode(Block &block, u16 pc, const u8 *page) {
+    block.page  = nullptr;
+    block.count = 0;
+
+    u32 offset = pc & 0xFF;
+    while (block.count < MAX_BLOCK_LENGTH) {
+        u8 opcode  = page[offset];
+        auto ins   = INSTRUCTION_LOOKUP[opcode];
+        u32 length = 1 + OPERAND_LENGTH_LOOKUP[ins.mode];
+
+        if (offset + length > 0x100) {
+            // operand continues on the next page, which may be mapped anywhere
+            break;
+        }
+
+        u16 operand = 0;
+        if (length == 2) {
+            operand = page[offset + 1];
+        } else if (length == 3) {
+            operand = page[offset + 1] | (page[offset + 2] << 8);
+        }
+
+        block.instructions[block.count] = {Cpu::DECODED_DISPATCH_TABLE[opcode], operand, opcode};
+        block.count++;
+
+        offset += length;
+        if (ends_block(ins.op) || offset == 0x100) {
+            break;
+        }
+    }
+
+    if (block.count == 0) {
+        return false;
+    }
+
+    block.page = page;
+    block.pc   = pc;
+
+    // code running from RAM, make sure we hear about writes to it
+    if (bus->get_write_page(pc >> 8) != nullptr) {
+        protect_writes(pc >> 8);
+    }
+
+    return true;
+}
+
+//
+
+void BlockCache::protect_writes(u8 page) {
+    u8 *hostPage = bus->get_write_page(page);
+
+    // protect every mirror of the host page as well
+    for (u32 p = 0; p < Bus::PAGE_COUNT; p++) {
+        if (bus->get_write_page(p) != hostPage) {
+            continue;
+        }
+
+        traps[p] = {hostPage, bus->get_handler(p)};
+
+        bus->map_page(p, bus->get_read_page(p), nullptr);
+        bus->map_handler(p, p, {traps[p].handler.read, write_trapped, this});
+    }
+}
+
+void BlockCache::unprotect_writes(u8 *hostPage) {
+    for (u32 p = 0; p < Bus::PAGE_COUNT; p++) {
+        if (traps[p].write == hostPage) {
+            remove_trap(p);
+        }
+    }
+
+    for (auto &block : blocks) {
+        if (block.page == hostPage) {
+            block.page = nullptr;
+        }
+    }
+
+    generation++;
+}
+
+void BlockCache::remove_trap(u32 page) {
+    // only restore the mapping if nothing has remapped the page in the meantime
+    const auto &h = bus->get_handler(page);
+    if (h.write == write_trapped && h.context == this && bus->get_write_page(page) == nullptr) {
+        bus->map_page(page, bus->get_read_page(page), traps[page].write);
+        bus->map_handler(page, page, traps[page].handler);
+    }
+
+    traps[page] = {};
+}
+
+void BlockCache::write_trapped(void *context, u16 address, u8 data) {
+    auto cache   = static_cast<BlockCache *>(context);
+    u8 *hostPage = cache->traps[address >> 8].write;
+
+    cache->unprotect_writes(hostPage);
+    cache->invalidations++;
+
+    hostPage[address & 0xFF] = data;
+}
@@ -1,49 +1,66 @@
 #include "nes/bus.hpp"
+#include "nes/ppu.hpp"
 
 using namespace nes;
 using namespace std;
 
-u8 Bus::read_u8(u16 address) {
-    u16 mirroredAddr;
-    if (address >= 0x0000 && address <= 0x1FFF) {
-        mirroredAddr = address & 0x07FF;
-        return mem->read_u8(mirroredAddr);
-    } else if (address >= 0x2000 && address <= 0x3FFF) {
-        mirroredAddr = address & 0x2007;
-        // PPU registers, not implemented yet
-    } else if (address >= 0x4000 && address <=  0x401F) {
-        // APU and I/O functionality
-    } else if (address >= 4020 && address <= 0xFFFF) {
-        // Rom space(PRG ROM, PRG RAM), not implemented yet
-    }
+//
+
+static constexpr u16 IO_REGISTER_END = 0x4020;
+
+static u8 open_bus_read(void *, u16) {
+    // nothing drives the bus here, not emulating the open bus behaviour for now
     return 0;
 }
 
-u16 Bus::read_u16(u16 address) {
-    u16 lo = read_u8(address);
-    u16 hi = read_u8(address + 1);
-    return (hi << 8) | lo;
+static void open_bus_write(void *, u16, u8) {
+    // unmapped, write is dropped
+}
+
+static u8 ppu_read(void *context, u16 address) {
+    return static_cast<Ppu *>(context)->read_register(address);
+}
+
+static void ppu_write(void *context, u16 address, u8 data) {
+    static_cast<Ppu *>(context)->write_register(address, data);
 }
 
-void Bus::write_u8(u8 data, u16 address) {
-    u16 mirroredAddr;
-    if (address >= 0x0000 && address <= 0x1FFF) {
-        mirroredAddr = address & 0x07FF;
-        mem->write_u8(data, mirroredAddr);
-    } else if (address >= 0x2000 && address <= 0x3FFF) {
-        // PPU registers, not implemented yet
-    } else if (address >= 0x4000 && address <= 0x401F) {
-        // APU and I/O functionality
-    } else if (address >= 4020 && address <= 0xFFFF) {
-        // Rom space(PRG ROM, PRG RAM), not implemented yet
+//
+
+Bus::Bus() {
+    ioHandler   = {open_bus_read, open_bus_write, nullptr};
+    cartHandler = {open_bus_read, open_bus_write, nullptr};
+
+    // everything is unmapped until components are attached
+    map_handler(0x00, 0xFF, {open_bus_read, open_bus_write, nullptr});
+    map_handler(0x40, 0x40, {read_split_page, write_split_page, this});
+}
+
+//
+
+void Bus::map_page(u8 page, const u8 *read, u8 *write) {
+    readPages[page]  = read;
+    writePages[page] = write;
+}
+
+void Bus::map_handler(u8 firstPage, u8 lastPage, PageHandler handler) {
+    for (u32 page = firstPage; page <= lastPage; page++) {
+        handlers[page] = handler;
     }
 }
 
-void Bus::write_u16(u16 data, u16 address) {
-    u8 lo = (data & 0xFF);
-    u8 hi = (data >> 8) & 0xFF;
-    write_u8(lo, address);
-    write_u8(hi, address + 1);
+//
+
+u8 Bus::read_split_page(void *context, u16 address) {
+    auto bus = static_cast<Bus *>(context);
+    auto &h  = address < IO_REGISTER_END ? bus->ioHandler : bus->cartHandler;
+    return h.read(h.context, address);
+}
+
+void Bus::write_split_page(void *context, u16 address, u8 data) {
+    auto bus = static_cast<Bus *>(context);
+    auto &h  = address < IO_REGISTER_END ? bus->ioHandler : bus->cartHandler;
+    h.write(h.context, address, data);
 }
 
 //
@@ -52,8 +69,30 @@ void Bus::attach_components(Cpu *c, Mem *m) {
     mem = m;
     c->connect_bus(this);
     m->reset();
+
+    // $0000-$1FFF, 2 KiB of internal RAM mirrored four times
+    for (u32 page = 0x00; page <= 0x1F; page++) {
+        u8 *base = mem->data() + ((page & 0x07) << 8);
+        map_page(page, base, base);
+    }
+}
+
+void Bus::attach_cartridge(PageHandler handler) {
+    cartHandler = handler;
+
+    // $4020-$FFFF, cartridge space. $4020-$40FF goes through the split page handler
+    map_handler(0x41, 0xFF, cartHandler);
+    for (u32 page = 0x41; page <= 0xFF; page++) {
+        map_page(page, nullptr, nullptr);
+    }
+}
+
+void Bus::attach_ppu(Ppu *ppu) {
+    // $2000-$3FFF, PPU registers mirrored every 8 bytes
+    map_handler(0x20, 0x3F, {ppu_read, ppu_write, ppu});
 }
 
-void Bus::attach_rom(Rom *r) {
-    rom = r;
+void Bus::attach_io(PageHandler handler) {
+    // $4000-$401F, shares its page with the cartridge so it goes through the split page handler
+    ioHandler = handler;
 }
@@ -0,0 +1,42 @@
+#include "nes/controller.hpp"
+
+using namespace nes;
+
+//
+
+void Controllers::save_state(State &state) const {
+    state.buttons = buttons;
+    state.shift   = shift;
+    state.strobe  = strobe;
+}
+
+void Controllers::load_state(const State &state) {
+    buttons = state.buttons;
+    shift   = state.shift;
+    strobe  = state.strobe;
+}
+
+//
+
+u8 Controllers::read(u16 address) {
+    u32 port = address & 0x01;
+
+    // while strobe is high the register keeps reloading, so every read returns A
+    if (strobe) {
+        return (buttons[port] & btn_A) | 0x40;
+    }
+
+    // after all 8 buttons the official controller shifts in 1s. bit 6 is open bus, which is
+    // usually the $40 of the address high byte
+    u8 bit      = shift[port] & 0x01;
+    shift[port] = (shift[port] >> 1) | 0x80;
+    return bit | 0x40;
+}
+
+void Controllers::write_strobe(u8 data) {
+    bool high = (data & 0x01) != 0;
+    if (strobe && !high) {
+        shift = buttons;
+    }
+    strobe = high;
+}
@@ -0,0 +1,301 @@
+#include "nes/core.hpp"
+
+#include "nes/profiler.hpp"
+
+#include "common/log.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+using namespace nes;
+
+//
+
+static constexpr std::array<char, 4> SAVE_STATE_MAGIC = {'N', 'E', 'S', 'S'};
+
+/// cpu cycles an OAM DMA takes: a halt cycle, then 256 read / write pairs. one more to align
+/// when it starts on an odd cycle
+static constexpr u32 OAM_DMA_CYCLES = 513;
+
+/// bytes of a save state before PRG and CHR RAM
+static constexpr size_t SAVE_STATE_FIXED_SIZE = sizeof(SaveStateHeader) + sizeof(Cpu::State) +
+                                                sizeof(Ppu::State) + Mem::MEM_SIZE_BYTES +
+                                                sizeof(Scheduler::State) + sizeof(Mapper::State) +
+                                                sizeof(Controllers::State) + sizeof(Apu::State);
+
+template <typename T>
+static u8 *write_block(u8 *out, const T &value) {
+    std::memcpy(out, &value, sizeof(T));
+    return out + sizeof(T);
+}
+
+template <typename T>
+static const u8 *read_block(const u8 *in, T &value) {
+    std::memcpy(&value, in, sizeof(T));
+    return in + sizeof(T);
+}
+
+//
+
+Core::Core() : bus(), cpu(), mem(), ppu() {
+    bus.attach_components(&cpu, &mem);
+    bus.attach_ppu(&ppu);
+    bus.attach_io({read_io, write_io, this});
+    blockCache.attach(&cpu, &bus);
+    scheduler.attach(&cpu, &blockCache);
+    scheduler.set_handler(ev_NMI, on_nmi, this);
+    ppu.attach(&scheduler);
+    apu.attach(&cpu, &bus, &scheduler);
+}
+
+//
+
+bool Core::load_rom(const std::string &filepath) {
+    return load_rom(std::make_shared<const Rom>(filepath.c_str(), romDatabase));
+}
+
+bool Core::load_rom(std::shared_ptr<const Rom> image) {
+    if (image == nullptr || !image->is_ok()) {
+        return false;
+    }
+
+    auto m = Mapper::create(image.get());
+    if (m == nullptr) {
+        return false;
+    }
+
+    // blocks are keyed by host pointers into the old rom, drop them before it goes away
+    blockCache.invalidate_all();
+
+    // the old mapper points into the old rom, so it has to go first
+    mapper = std::move(m);
+    rom    = std::move(image);
+    mapper->attach(&bus, &ppu, &cpu, &scheduler);
+
+    reset();
+    return true;
+}
+
+void Core::reset() {
+    ppu.reset();
+    apu.reset();
+    cpu.reset();
+}
+
+//
+
+u64 Core::step() {
+    u64 before = cpu.cyclesExecuted;
+
+    // a one tick target stops the scheduler after a single instruction, plus any due events
+    scheduler.run_until(scheduler.now() + 1);
+
+    return cpu.cyclesExecuted - before;
+}
+
+u64 Core::run_cycles(u64 cycles) {
+    u64 start = cpu.cyclesExecuted;
+
+    scheduler.run_until(scheduler.now() + cycles * Scheduler::MASTER_CYCLES_PER_CPU_CYCLE);
+
+    return cpu.cyclesExecuted - start;
+}
+
+u64 Core::run_frame() {
+    u64 start = cpu.cyclesExecuted;
+    scheduler.run_until(ppu.get_next_vblank());
+    apu.end_frame();
+    return cpu.cyclesExecuted - start;
+}
+
+//
+
+size_t Core::get_save_state_size() const {
+    if (rom == nullptr) {
+        return 0;
+    }
+    return SAVE_STATE_FIXED_SIZE + rom->get_prg_ram_size() +
+           (rom->has_chr_ram() ? rom->get_chr_size() : 0);
+}
+
+bool Core::save_state(u8 *buffer, size_t size) const {
+    size_t stateSize = get_save_state_size();
+    if (stateSize == 0 || size < stateSize) {
+        return false;
+    }
+
+    // the component states are small enough to build on the stack, so this never allocates. they
+    // are cleared first so padding doesn't leak stack contents, identical emulation state must
+    // give identical bytes for rewind deltas and state hashes
+    Cpu::State cpuState;
+    Ppu::State ppuState;
+    Scheduler::State schedulerState;
+    Mapper::State mapperState;
+    Controllers::State controllersState;
+    Apu::State apuState;
+
+    std::memset(&cpuState, 0, sizeof(cpuState));
+    std::memset(&ppuState, 0, sizeof(ppuState));
+    std::memset(&schedulerState, 0, sizeof(schedulerState));
+    std::memset(&mapperState, 0, sizeof(mapperState));
+    std::memset(&controllersState, 0, sizeof(controllersState));
+    std::memset(&apuState, 0, sizeof(apuState));
+
+    cpu.save_state(cpuState);
+    ppu.save_state(ppuState);
+    scheduler.save_state(schedulerState);
+    mapper->save_state(mapperState);
+    controllers.save_state(controllersState);
+    apu.save_state(apuState);
+
+    SaveStateHeader header = {SAVE_STATE_MAGIC, SAVE_STATE_VERSION, (u32) stateSize,
+                              rom->get_crc32()};
+
+    u8 *out = write_block(buffer, header);
+    out     = write_block(out, cpuState);
+    out     = write_block(out, ppuState);
+    std::memcpy(out, mem.data(), Mem::MEM_SIZE_BYTES);
+    out += Mem::MEM_SIZE_BYTES;
+    out = write_block(out, schedulerState);
+    out = write_block(out, mapperState);
+    out = write_block(out, controllersState);
+    out = write_block(out, apuState);
+    if (const u8 *prgRam = mapper->get_prg_ram()) {
+        std::memcpy(out, prgRam, rom->get_prg_ram_size());
+        out += rom->get_prg_ram_size();
+    }
+    if (const u8 *chrRam = mapper->get_chr_ram()) {
+        std::memcpy(out, chrRam, rom->get_chr_size());
+    }
+
+    return true;
+}
+
+bool Core::load_state(const u8 *buffer, size_t size) {
+    size_t stateSize = get_save_state_size();
+    if (stateSize == 0 || size < stateSize) {
+        return false;
+    }
+
+    SaveStateHeader header;
+    const u8 *in = read_block(buffer, header);
+    if (header.magic != SAVE_STATE_MAGIC || header.version != SAVE_STATE_VERSION ||
+        header.size != stateSize || header.romCrc32 != rom->get_crc32()) {
+        return false;
+    }
+
+    Cpu::State cpuState;
+    Ppu::State ppuState;
+    Scheduler::State schedulerState;
+    Mapper::State mapperState;
+    Controllers::State controllersState;
+    Apu::State apuState;
+
+    in = read_block(in, cpuState);
+    in = read_block(in, ppuState);
+    std::memcpy(mem.data(), in, Mem::MEM_SIZE_BYTES);
+    in += Mem::MEM_SIZE_BYTES;
+    in = read_block(in, schedulerState);
+    in = read_block(in, mapperState);
+    in = read_block(in, controllersState);
+    in = read_block(in, apuState);
+    if (u8 *prgRam = mapper->get_prg_ram()) {
+        std::memcpy(prgRam, in, rom->get_prg_ram_size());
+        in += rom->get_prg_ram_size();
+    }
+    if (u8 *chrRam = mapper->get_chr_ram()) {
+        std::memcpy(chrRam, in, rom->get_chr_size());
+    }
+
+    // RAM was replaced behind the block cache's write traps
+    blockCache.invalidate_writable();
+
+    cpu.load_state(cpuState);
+    ppu.load_state(ppuState);
+    scheduler.load_state(schedulerState);
+    mapper->load_state(mapperState);
+    controllers.load_state(controllersState);
+    apu.load_state(apuState);
+
+    if (cpu.profiler != nullptr) {
+        cpu.profiler->resync(cpu.PC);
+    }
+
+    return true;
+}
+
+bool Core::save_state_file(const std::string &filepath) const {
+    std::vector<u8> buffer(get_save_state_size());
+    if (!save_state(buffer.data(), buffer.size())) {
+        return false;
+    }
+
+    std::ofstream file(filepath, std::ios::binary);
+    file.write((const char *) buffer.data(), buffer.size());
+    if (!file) {
+        log_message(log_ERROR, "Failed to write save state: {}", filepath);
+        return false;
+    }
+    return true;
+}
+
+bool Core::load_state_file(const std::string &filepath) {
+    std::ifstream file(filepath, std::ios::binary);
+    std::vector<u8> buffer(get_save_state_size());
+    file.read((char *) buffer.data(), buffer.size());
+
+    if (!file || !load_state(buffer.data(), buffer.size())) {
+        log_message(log_ERROR, "Failed to load save state: {}", filepath);
+        return false;
+    }
+    return true;
+}
+
+//
+
+void Core::on_nmi(void *context, u64) {
+    static_cast<Core *>(context)->cpu.nmi();
+}
+
+u8 Core::read_io(void *context, u16 address) {
+    auto core = static_cast<Core *>(context);
+    if (address == 0x4016 || address == 0x4017) {
+        return core->controllers.read(address);
+    }
+    if (address == 0x4015) {
+        return core->apu.read_status();
+    }
+    return 0;
+}
+
+void Core::write_io(void *context, u16 address, u8 data) {
+    auto core = static_cast<Core *>(context);
+    if (address == 0x4016) {
+        core->controllers.write_strobe(data);
+    } else if (address == 0x4014) {
+        core->oam_dma(data);
+    } else if (address <= 0x4013 || address == 0x4015 || address == 0x4017) {
+        core->apu.write_register(address, data);
+    }
+}
+
+void Core::oam_dma(u8 page) {
+    // the transfer starts once the writing instruction is done
+    u64 start = cpu.cyclesExecuted + cpu.cyclesRemaining;
+
+    // ram and rom pages are copied straight from host memory, only register pages (which no
+    // game uses as a source) go through the page handler byte by byte
+    const u8 *source = bus.get_read_page(page);
+    if (source != nullptr) {
+        ppu.write_oam_dma(source);
+    } else {
+        std::array<u8, 256> data;
+        for (u32 i = 0; i < data.size(); i++) {
+            data[i] = bus.read_u8((u16) ((page << 8) | i));
+        }
+        ppu.write_oam_dma(data.data());
+    }
+
+    cpu.stall(OAM_DMA_CYCLES + (start & 1));
+}
@@ -0,0 +1,65 @@
+#include "nes/core_batch.hpp"
+
+#include <cstring>
+
+using namespace nes;
+
+//
+
+CoreBatch::CoreBatch(u32 coreCount, u32 threads) : pool(threads) {
+    cores.reserve(coreCount);
+    for (u32 i = 0; i < coreCount; i++) {
+        cores.push_back(std::make_unique<Core>());
+    }
+}
+
+bool CoreBatch::load_rom(const std::string &filepath) {
+    // one image for all cores, each only gets its own cartridge RAM
+    auto image = std::make_shared<const Rom>(filepath.c_str());
+    for (auto &core : cores) {
+        if (!core->load_rom(image)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CoreBatch::reset() {
+    for (auto &core : cores) {
+        core->reset();
+    }
+}
+
+//
+
+void CoreBatch::step(const u8 *actions, const BatchObservations &observations) {
+    stepActions      = actions;
+    stepObservations = observations;
+
+    pool.parallel_for((u32) cores.size(), step_core, this);
+}
+
+void CoreBatch::step_core(void *context, u32 index) {
+    auto batch                   = static_cast<CoreBatch *>(context);
+    const BatchObservations &out = batch->stepObservations;
+    Core &core                   = *batch->cores[index];
+
+    core.controllers.set_buttons(0, batch->stepActions[index]);
+
+    // steps run from vblank to vblank, so every line of the caller's frame slot gets rendered
+    if (out.frames != nullptr) {
+        core.ppu.set_output(out.frames + index * FRAME_SIZE);
+    }
+    for (u32 i = 0; i < batch->frameSkip; i++) {
+        core.run_frame();
+    }
+    core.ppu.set_output(nullptr);
+
+    if (out.ram != nullptr) {
+        std::memcpy(out.ram + index * RAM_SIZE, core.mem.data(), RAM_SIZE);
+    }
+    if (out.rewards != nullptr) {
+        out.rewards[index] =
+            batch->reward != nullptr ? batch->reward(batch->rewardContext, core, index) : 0.0f;
+    }
+}
@@ -1,5 +1,6 @@
 #include "nes/cpu.hpp"
 #include "nes/bus.hpp"
+#include "nes/trace_ring.hpp"
 
 #include <iostream>
 #include <sstream>
@@ -46,6 +47,7 @@ void Cpu::irq() {
         PC = bus->read_u16(0xFFFE);
 
         cyclesRemaining = 7;
+        cyclesExecuted += 7;
     }
 }
 
@@ -63,12 +65,49 @@ void Cpu::nmi() {
 
     PC = bus->read_u16(0xFFFA);
 
-    cyclesRemaining += 7;
+    cyclesRemaining = 7;
+    cyclesExecuted += 7;
+}
+
+void Cpu::save_state(State &state) const {
+    state.A               = A;
+    state.X               = X;
+    state.Y               = Y;
+    state.P               = P;
+    state.SP              = SP;
+    state.PC              = PC;
+    state.instruction     = instruction;
+    state.cyclesRemaining = cyclesRemaining;
+    state.irqLine         = irqLine;
+    state.cyclesExecuted  = cyclesExecuted;
+}
+
+void Cpu::load_state(const State &state) {
+    A               = state.A;
+    X               = state.X;
+    Y               = state.Y;
+    P               = state.P;
+    SP              = state.SP;
+    PC              = state.PC;
+    instruction     = state.instruction;
+    cyclesRemaining = state.cyclesRemaining;
+    irqLine         = state.irqLine;
+    cyclesExecuted  = state.cyclesExecuted;
 }
 
 //
 
 void Cpu::clock() {
+    u8 opcode = bus->read_u8(PC);
+    if (trace != nullptr) {
+        trace->record(*this, PC, opcode, bus->peek_u8(PC + 1) | (bus->peek_u8(PC + 2) << 8));
+    }
+    PC += 1;
+
+    DISPATCH_TABLE[opcode](*this);
+}
+
+void Cpu::clock_reference() {
     auto opcode = bus->read_u8(PC);
     PC += 1;
 
@@ -81,6 +120,412 @@ void Cpu::clock() {
 
 //
 
+/// operations that only read their operand take an extra cycle when indexing crosses a page
+static constexpr bool has_page_penalty(OperationType op, AddressingMode mode) {
+    if (mode != am_ABX && mode != am_ABY && mode != am_INY) {
+        return false;
+    }
+
+    switch (op) {
+    case op_ADC: case op_AND: case op_CMP: case op_EOR: case op_LDA: case op_LDX: case op_LDY:
+    case op_ORA: case op_SBC: case op_LAX: case op_NOP:
+        return true;
+    default:
+        return false;
+    }
+}
+
+template <std::size_t... Opcodes>
+constexpr std::array<Cpu::OpcodeHandler, 256> Cpu::make_dispatch_table(
+    std::index_sequence<Opcodes...>) {
+    return {&Cpu::run_opcode<static_cast<u8>(Opcodes)>...};
+}
+
+template <std::size_t... Opcodes>
+constexpr std::array<Cpu::DecodedHandler, 256> Cpu::make_decoded_dispatch_table(
+    std::index_sequence<Opcodes...>) {
+    return {&Cpu::run_decoded<static_cast<u8>(Opcodes)>...};
+}
+
+const std::array<Cpu::OpcodeHandler, 256> Cpu::DISPATCH_TABLE =
+    Cpu::make_dispatch_table(std::make_index_sequence<256>{});
+
+const std::array<Cpu::DecodedHandler, 256> Cpu::DECODED_DISPATCH_TABLE =
+    Cpu::make_decoded_dispatch_table(std::make_index_sequence<256>{});
+
+template <u8 opcode>
+void Cpu::run_opcode(Cpu &cpu) {
+    constexpr u8 length = OPERAND_LENGTH_LOOKUP[INSTRUCTION_LOOKUP[opcode].mode];
+
+    u16 operand = 0;
+    if constexpr (length == 1) {
+        operand = cpu.bus->read_u8(cpu.PC);
+    } else if constexpr (length == 2) {
+        operand = cpu.bus->read_u16(cpu.PC);
+    }
+    cpu.PC += length;
+
+    cpu.complete_opcode<opcode>(operand);
+}
+
+template <u8 opcode>
+void Cpu::run_decoded(Cpu &cpu, u16 operand) {
+    cpu.PC += 1 + OPERAND_LENGTH_LOOKUP[INSTRUCTION_LOOKUP[opcode].mode];
+
+    cpu.complete_opcode<opcode>(operand);
+}
+
+template <u8 opcode>
+void Cpu::complete_opcode(u16 operand) {
+    constexpr OperationType op     = INSTRUCTION_LOOKUP[opcode].op;
+    constexpr AddressingMode mode  = INSTRUCTION_LOOKUP[opcode].mode;
+    constexpr bool pagePenalty     = has_page_penalty(op, mode);
+
+    cyclesRemaining = CYCLE_COUNT_LOOKUP[opcode];
+
+    u16 address = resolve_address<mode, pagePenalty>(operand);
+    instruction = {op, mode, address};
+
+    execute<op, mode>(address);
+
+    cyclesExecuted += cyclesRemaining;
+}
+
+template <AddressingMode mode, bool pagePenalty>
+u16 Cpu::resolve_address(u16 operand) {
+    if constexpr (mode == am_ABS) {
+        return operand;
+    } else if constexpr (mode == am_ABX || mode == am_ABY) {
+        u16 address = operand + (mode == am_ABX ? X : Y);
+        if constexpr (pagePenalty) {
+            handle_page_break(operand, address);
+        }
+        return address;
+    } else if constexpr (mode == am_IMM) {
+        return PC - 1; // the operand byte itself
+    } else if constexpr (mode == am_IMP) {
+        return 0;
+    } else if constexpr (mode == am_IND) {
+        // same 6502 page boundary bug as in get_operand_address
+        u16 lo = bus->read_u8(operand);
+        u16 hi = bus->read_u8((operand & 0xFF00) | ((operand + 1) & 0x00FF));
+        return (hi << 8) | lo;
+    } else if constexpr (mode == am_INX) {
+        u16 lo = bus->read_u8((operand + X) & 0xFF);
+        u16 hi = bus->read_u8((operand + X + 1) & 0xFF);
+        return (hi << 8) | lo;
+    } else if constexpr (mode == am_INY) {
+        u16 lo = bus->read_u8(operand & 0xFF);
+        u16 hi = bus->read_u8((operand + 1) & 0xFF);
+
+        u16 base    = (hi << 8) | lo;
+        u16 address = base + Y;
+        if constexpr (pagePenalty) {
+            handle_page_break(base, address);
+        }
+        return address;
+    } else if constexpr (mode == am_REL) {
+        return PC + (int8_t) operand;
+    } else if constexpr (mode == am_ZP0) {
+        return operand;
+    } else if constexpr (mode == am_ZPX) {
+        return (operand + X) & 0x00FF;
+    } else if constexpr (mode == am_ZPY) {
+        return (operand + Y) & 0x00FF;
+    }
+}
+
+template <OperationType op, AddressingMode mode>
+void Cpu::execute(u16 addr) {
+    if constexpr (op == op_ADC) {
+        add_with_carry(bus->read_u8(addr));
+    } else if constexpr (op == op_AND) {
+        A &= bus->read_u8(addr);
+        set_ZN_status(A);
+    } else if constexpr (op == op_ASL) {
+        u16 M = mode == am_IMP ? A : bus->read_u8(addr);
+
+        M <<= 1;
+        set_C_status((M & 0xFF00) != 0);
+        set_ZN_status(M & 0x00FF);
+
+        if constexpr (mode == am_IMP) {
+            A = M & 0xFF;
+        } else {
+            bus->write_u8(M & 0xFF, addr);
+        }
+    } else if constexpr (op == op_BCC) {
+        if ((P & C) == 0) {
+            branch_to(addr);
+        }
+    } else if constexpr (op == op_BCS) {
+        if ((P & C) != 0) {
+            branch_to(addr);
+        }
+    } else if constexpr (op == op_BEQ) {
+        if ((P & Z) != 0) {
+            branch_to(addr);
+        }
+    } else if constexpr (op == op_BIT) {
+        u8 M = bus->read_u8(addr);
+
+        set_Z_status((A & M) == 0);
+        set_N_status((M & 0x80) != 0);
+        set_V_status((M & 0x40) != 0);
+    } else if constexpr (op == op_BMI) {
+        if ((P & N) != 0) {
+            branch_to(addr);
+        }
+    } else if constexpr (op == op_BNE) {
+        if ((P & Z) == 0) {
+            branch_to(addr);
+        }
+    } else if constexpr (op == op_BPL) {
+        if ((P & N) == 0) {
+            branch_to(addr);
+        }
+    } else if constexpr (op == op_BRK) {
+        set_I_status(true);
+        set_B_status(true);
+
+        bus->write_u8(PC >> 8, STACK_START + SP);
+        SP -= 1;
+        bus->write_u8(PC & 0xFF, STACK_START + SP);
+        SP -= 1;
+
+        bus->write_u8(P | B, STACK_START + SP);
+        SP -= 1;
+
+        PC = bus->read_u16(0xFFFE);
+
+        set_B_status(false);
+    } else if constexpr (op == op_BVC) {
+        if ((P & V) == 0) {
+            branch_to(addr);
+        }
+    } else if constexpr (op == op_BVS) {
+        if ((P & V) != 0) {
+            branch_to(addr);
+        }
+    } else if constexpr (op == op_CLC) {
+        set_C_status(false);
+    } else if constexpr (op == op_CLD) {
+        set_D_status(false);
+    } else if constexpr (op == op_CLI) {
+        set_I_status(false);
+    } else if constexpr (op == op_CLV) {
+        set_V_status(false);
+    } else if constexpr (op == op_CMP || op == op_CPX || op == op_CPY) {
+        compare(op == op_CMP ? A : (op == op_CPX ? X : Y), bus->read_u8(addr));
+    } else if constexpr (op == op_DEC) {
+        u8 M = bus->read_u8(addr) - 1;
+        set_ZN_status(M);
+        bus->write_u8(M, addr);
+    } else if constexpr (op == op_DEX) {
+        X -= 1;
+        set_ZN_status(X);
+    } else if constexpr (op == op_DEY) {
+        Y -= 1;
+        set_ZN_status(Y);
+    } else if constexpr (op == op_EOR) {
+        A ^= bus->read_u8(addr);
+        set_ZN_status(A);
+    } else if constexpr (op == op_INC) {
+        u8 M = bus->read_u8(addr) + 1;
+        set_ZN_status(M);
+        bus->write_u8(M, addr);
+    } else if constexpr (op == op_INX) {
+        X += 1;
+        set_ZN_status(X);
+    } else if constexpr (op == op_INY) {
+        Y += 1;
+        set_ZN_status(Y);
+    } else if constexpr (op == op_JMP) {
+        PC = addr;
+    } else if constexpr (op == op_JSR) {
+        PC -= 1;
+
+        bus->write_u8(PC >> 8, STACK_START + SP);
+        SP -= 1;
+        bus->write_u8(PC & 0xFF, STACK_START + SP);
+        SP -= 1;
+
+        PC = addr;
+    } else if constexpr (op == op_LDA) {
+        A = bus->read_u8(addr);
+        set_ZN_status(A);
+    } else if constexpr (op == op_LDX) {
+        X = bus->read_u8(addr);
+        set_ZN_status(X);
+    } else if constexpr (op == op_LDY) {
+        Y = bus->read_u8(addr);
+        set_ZN_status(Y);
+    } else if constexpr (op == op_LSR) {
+        u8 M = mode == am_IMP ? A : bus->read_u8(addr);
+
+        set_C_status((M & 0x01) != 0);
+        M >>= 1;
+        set_ZN_status(M);
+
+        if constexpr (mode == am_IMP) {
+            A = M;
+        } else {
+            bus->write_u8(M, addr);
+        }
+    } else if constexpr (op == op_NOP) {
+        // nothing changed
+    } else if constexpr (op == op_ORA) {
+        A |= bus->read_u8(addr);
+        set_ZN_status(A);
+    } else if constexpr (op == op_PHA) {
+        bus->write_u8(A, STACK_START + SP);
+        SP -= 1;
+    } else if constexpr (op == op_PHP) {
+        set_B_status(true);
+        bus->write_u8(P, STACK_START + SP);
+        SP -= 1;
+        set_B_status(false);
+    } else if constexpr (op == op_PLA) {
+        SP += 1;
+        A = bus->read_u8(STACK_START + SP);
+        set_ZN_status(A);
+    } else if constexpr (op == op_PLP) {
+        SP += 1;
+        P = (bus->read_u8(STACK_START + SP) & ~B) | U; // B only exists on the stack
+    } else if constexpr (op == op_ROL) {
+        u8 M = mode == am_IMP ? A : bus->read_u8(addr);
+
+        u8 rotated = M << 1;
+        rotated |= ((P & C) != 0) ? 1 : 0;
+
+        set_C_status((M & 0x80) != 0);
+        set_ZN_status(rotated);
+
+        if constexpr (mode == am_IMP) {
+            A = rotated;
+        } else {
+            bus->write_u8(rotated, addr);
+        }
+    } else if constexpr (op == op_ROR) {
+        u8 M = mode == am_IMP ? A : bus->read_u8(addr);
+
+        u8 rotated = M >> 1;
+        rotated |= ((P & C) != 0) ? 0x80 : 0;
+
+        set_C_status((M & 1) != 0);
+        set_ZN_status(rotated);
+
+        if constexpr (mode == am_IMP) {
+            A = rotated;
+        } else {
+            bus->write_u8(rotated, addr);
+        }
+    } else if constexpr (op == op_RTI) {
+        SP += 1;
+        P  = (bus->read_u8(STACK_START + SP) & ~B) | U;
+        PC = bus->read_u16(STACK_START + SP + 1);
+        SP += 2;
+    } else if constexpr (op == op_RTS) {
+        PC = bus->read_u16(STACK_START + SP + 1);
+        SP += 2;
+        PC += 1;
+    } else if constexpr (op == op_SBC) {
+        add_with_carry(bus->read_u8(addr) ^ 0xFF);
+    } else if constexpr (op == op_SEC) {
+        set_C_status(true);
+    } else if constexpr (op == op_SED) {
+        set_D_status(true);
+    } else if constexpr (op == op_SEI) {
+        set_I_status(true);
+    } else if constexpr (op == op_STA) {
+        bus->write_u8(A, addr);
+    } else if constexpr (op == op_STX) {
+        bus->write_u8(X, addr);
+    } else if constexpr (op == op_STY) {
+        bus->write_u8(Y, addr);
+    } else if constexpr (op == op_TAX) {
+        X = A;
+        set_ZN_status(X);
+    } else if constexpr (op == op_TAY) {
+        Y = A;
+        set_ZN_status(Y);
+    } else if constexpr (op == op_TSX) {
+        X = SP;
+        set_ZN_status(X);
+    } else if constexpr (op == op_TXA) {
+        A = X;
+        set_ZN_status(A);
+    } else if constexpr (op == op_TXS) {
+        SP = X; // the only transfer that leaves the flags alone
+    } else if constexpr (op == op_TYA) {
+        A = Y;
+        set_ZN_status(A);
+    } else if constexpr (op == op_LAX) {
+        A = X = bus->read_u8(addr);
+        set_ZN_status(A);
+    } else if constexpr (op == op_SAX) {
+        bus->write_u8(A & X, addr);
+    } else if constexpr (op == op_DCP) {
+        u8 M = bus->read_u8(addr) - 1;
+        bus->write_u8(M, addr);
+        compare(A, M);
+    } else if constexpr (op == op_ISC) {
+        u8 M = bus->read_u8(addr) + 1;
+        bus->write_u8(M, addr);
+        add_with_carry(M ^ 0xFF);
+    } else if constexpr (op == op_SLO) {
+        u8 M = bus->read_u8(addr);
+        set_C_status((M & 0x80) != 0);
+        M <<= 1;
+        bus->write_u8(M, addr);
+        A |= M;
+        set_ZN_status(A);
+    } else if constexpr (op == op_RLA) {
+        u8 M       = bus->read_u8(addr);
+        u8 rotated = (M << 1) | (((P & C) != 0) ? 1 : 0);
+        set_C_status((M & 0x80) != 0);
+        bus->write_u8(rotated, addr);
+        A &= rotated;
+        set_ZN_status(A);
+    } else if constexpr (op == op_SRE) {
+        u8 M = bus->read_u8(addr);
+        set_C_status((M & 0x01) != 0);
+        M >>= 1;
+        bus->write_u8(M, addr);
+        A ^= M;
+        set_ZN_status(A);
+    } else if constexpr (op == op_RRA) {
+        u8 M       = bus->read_u8(addr);
+        u8 rotated = (M >> 1) | (((P & C) != 0) ? 0x80 : 0);
+        set_C_status((M & 0x01) != 0);
+        bus->write_u8(rotated, addr);
+        add_with_carry(rotated);
+    } else if constexpr (op == op_ANC) {
+        A &= bus->read_u8(addr);
+        set_ZN_status(A);
+        set_C_status((A & 0x80) != 0);
+    } else if constexpr (op == op_ALR) {
+        A &= bus->read_u8(addr);
+        set_C_status((A & 0x01) != 0);
+        A >>= 1;
+        set_ZN_status(A);
+    } else if constexpr (op == op_ARR) {
+        A &= bus->read_u8(addr);
+        A = (A >> 1) | (((P & C) != 0) ? 0x80 : 0);
+        set_ZN_status(A);
+        set_C_status((A & 0x40) != 0);
+        set_V_status(((A >> 6) ^ (A >> 5)) & 1);
+    } else if constexpr (op == op_AXS) {
+        u8 M = bus->read_u8(addr);
+        compare(A & X, M);
+        X = (A & X) - M;
+    } else {
+        // unknown instruction, do nothing
+    }
+}
+
+//
+
 void Cpu::execute_instruction() {
     auto addr = instruction.address;
     switch (instruction.op) {
@@ -343,7 +788,7 @@ void Cpu::execute_instruction() {
     }
     case op_PLP: {
         SP += 1;
-        P = bus->read_u8(STACK_START + SP);
+        P = (bus->read_u8(STACK_START + SP) & ~B) | U; // B only exists on the stack
         break;
     }
     case op_ROL: {
@@ -381,7 +826,7 @@ void Cpu::execute_instruction() {
     case op_RTI: {
         // pull P-register first, then PC
         SP += 1;
-        P  = bus->read_u8(STACK_START + SP);
+        P  = (bus->read_u8(STACK_START + SP) & ~B) | U;
         PC = bus->read_u16(STACK_START + SP + 1);
         SP += 2;
         break;
@@ -450,8 +895,7 @@ void Cpu::execute_instruction() {
         break;
     }
     case op_TXS: {
-        SP = X;
-        set_ZN_status(SP);
+        SP = X; // the only transfer that leaves the flags alone
         break;
     }
     case op_TYA: {
@@ -459,6 +903,89 @@ void Cpu::execute_instruction() {
         set_ZN_status(A);
         break;
     }
+    case op_LAX: {
+        A = X = bus->read_u8(addr);
+        set_ZN_status(A);
+        break;
+    }
+    case op_SAX: {
+        bus->write_u8(A & X, addr);
+        break;
+    }
+    case op_DCP: {
+        u8 M = bus->read_u8(addr) - 1;
+        bus->write_u8(M, addr);
+        compare(A, M);
+        break;
+    }
+    case op_ISC: {
+        u8 M = bus->read_u8(addr) + 1;
+        bus->write_u8(M, addr);
+        add_with_carry(M ^ 0xFF);
+        break;
+    }
+    case op_SLO: {
+        u8 M = bus->read_u8(addr);
+        set_C_status((M & 0x80) != 0);
+        M <<= 1;
+        bus->write_u8(M, addr);
+        A |= M;
+        set_ZN_status(A);
+        break;
+    }
+    case op_RLA: {
+        u8 M       = bus->read_u8(addr);
+        u8 rotated = (M << 1) | (((P & C) != 0) ? 1 : 0);
+        set_C_status((M & 0x80) != 0);
+        bus->write_u8(rotated, addr);
+        A &= rotated;
+        set_ZN_status(A);
+        break;
+    }
+    case op_SRE: {
+        u8 M = bus->read_u8(addr);
+        set_C_status((M & 0x01) != 0);
+        M >>= 1;
+        bus->write_u8(M, addr);
+        A ^= M;
+        set_ZN_status(A);
+        break;
+    }
+    case op_RRA: {
+        u8 M       = bus->read_u8(addr);
+        u8 rotated = (M >> 1) | (((P & C) != 0) ? 0x80 : 0);
+        set_C_status((M & 0x01) != 0);
+        bus->write_u8(rotated, addr);
+        add_with_carry(rotated);
+        break;
+    }
+    case op_ANC: {
+        A &= bus->read_u8(addr);
+        set_ZN_status(A);
+        set_C_status((A & 0x80) != 0);
+        break;
+    }
+    case op_ALR: {
+        A &= bus->read_u8(addr);
+        set_C_status((A & 0x01) != 0);
+        A >>= 1;
+        set_ZN_status(A);
+        break;
+    }
+    case op_ARR: {
+        A &= bus->read_u8(addr);
+        A = (A >> 1) | (((P & C) != 0) ? 0x80 : 0);
+        set_ZN_status(A);
+        set_C_status((A & 0x40) != 0);
+        set_V_status(((A >> 6) ^ (A >> 5)) & 1);
+        break;
+    }
+    case op_AXS: {
+        u8 M = bus->read_u8(addr);
+        compare(A & X, M);
+        X = (A & X) - M;
+        break;
+    }
     case op_XXX: {
         // unknown instruction, do nothing
         break;
@@ -482,6 +1009,7 @@ u16 Cpu::get_operand_address() {
 
         switch (instruction.op) {
         case op_ASL: case op_DEC: case op_INC: case op_LSR: case op_ROL: case op_ROR: case op_STA:
+        case op_DCP: case op_ISC: case op_SLO: case op_RLA: case op_SRE: case op_RRA:
             // no change occurs to cycle times
             break;
         default:
@@ -497,11 +1025,11 @@ u16 Cpu::get_operand_address() {
         address = bus->read_u16(PC);
 
         switch (instruction.op) {
-        case op_STA:
+        case op_STA: case op_DCP: case op_ISC: case op_SLO: case op_RLA: case op_SRE: case op_RRA:
             // no change occurs to cycle times
             break;
         default:
-            handle_page_break(address, address + X);
+            handle_page_break(address, address + Y);
             break;
         }
 
@@ -549,11 +1077,11 @@ u16 Cpu::get_operand_address() {
         address = (hi << 8) | lo;
 
         switch (instruction.op) {
-        case op_STA:
+        case op_STA: case op_DCP: case op_ISC: case op_SLO: case op_RLA: case op_SRE: case op_RRA:
             // no change occurs to cycle times
             break;
         default:
-            handle_page_break(address, address + X);
+            handle_page_break(address, address + Y);
             break;
         }
 
@@ -563,9 +1091,10 @@ u16 Cpu::get_operand_address() {
     }
     case am_REL: {
         auto offset = (int8_t) bus->read_u8(PC); // signed offset for branching
+        PC += 1;
 
+        // offset is relative to the instruction following the branch
         address = PC + offset;
-        PC += 1;
         break;
     }
     case am_ZP0: {
@@ -626,9 +1155,26 @@ void Cpu::set_ZN_status(u8 num) {
     set_N_status((num & 0x80) == 0x80);
 }
 
+void Cpu::add_with_carry(u8 M) {
+    u16 sum = A + M + ((P & C) ? 1 : 0);
+    set_C_status((sum & 0xFF00) != 0);
+    set_ZN_status(sum & 0xFF);
+    set_V_status(((A ^ sum) & ~(A ^ M) & 0x80) != 0);
+
+    A = sum & 0xFF;
+}
+
+void Cpu::compare(u8 R, u8 M) {
+    set_C_status(R >= M);
+    set_Z_status(R == M);
+    set_N_status((R - M) & 0x80);
+}
+
 //
 
 void Cpu::branch_to(u16 address) {
+    // a taken branch costs one extra cycle, and one more if it lands on another page
+    cyclesRemaining++;
     handle_page_break(PC, address);
     PC = address;
 }
@@ -652,7 +1198,7 @@ std::vector<std::string> Cpu::registers_to_strings() const {
     };
 }
 
-std::string Cpu::get_executing_instruction() {
+std::string Cpu::get_executing_instruction() const {
     return fmt::format("{}#{} [0x{:04x}]", INSTRUCTION_NAME_LOOKUP[instruction.op],
                        ADDRMODE_NAME_LOOKUP[instruction.mode], instruction.address);
 }
\ No newline at end of file
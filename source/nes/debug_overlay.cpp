@@ -0,0 +1,61 @@
+#include "nes/debug_overlay.hpp"
+
+#include <cmath>
+
+using namespace nes;
+
+//
+
+static constexpr const char *REGISTER_NAMES[DebugOverlay::REGISTER_LINES] = {
+    "A ", "X ", "Y ", "P ", "SP", "PC",
+};
+
+//
+
+void DebugOverlay::update(const Cpu &cpu, const Status &status) {
+    std::array<u16, REGISTER_LINES> values = {cpu.A, cpu.X, cpu.Y, cpu.P, cpu.SP, cpu.PC};
+    for (u32 i = 0; i < REGISTER_LINES; i++) {
+        if (!formatted || values[i] != registerValues[i]) {
+            if (i < REGISTER_LINES - 1) {
+                registers[i].format("{} = 0x{:02x}", REGISTER_NAMES[i], values[i]);
+            } else {
+                registers[i].format("{} = 0x{:04x}", REGISTER_NAMES[i], values[i]);
+            }
+            registerValues[i] = values[i];
+        }
+    }
+
+    const Instruction &in = cpu.instruction;
+    if (!formatted || in.op != instructionValue.op || in.mode != instructionValue.mode ||
+        in.address != instructionValue.address) {
+        instruction.format("{}#{} [0x{:04x}]", INSTRUCTION_NAME_LOOKUP[in.op],
+                           ADDRMODE_NAME_LOOKUP[in.mode], in.address);
+        instructionValue = in;
+    }
+
+    u32 frameCost = (u32) std::lround(status.frameCost * 1e5);
+    if (!formatted || status.running != statusValue.running ||
+        status.fastForward != statusValue.fastForward ||
+        status.autoRunAhead != statusValue.autoRunAhead ||
+        status.runAheadFrames != statusValue.runAheadFrames || frameCost != frameCostShown) {
+        const char *mode = status.fastForward ? "fast forward"
+                           : status.running   ? "running"
+                                              : "paused";
+        statusLine.format("{}  run-ahead {}{}  {:.2f} ms / frame", mode, status.runAheadFrames,
+                          status.autoRunAhead ? " (auto)" : "", frameCost / 100.0);
+        statusValue    = status;
+        frameCostShown = frameCost;
+    }
+
+    u32 audioFill = (u32) std::lround(status.audioFill * 100.0);
+    if (!formatted || audioFill != audioFillShown || status.audioUnderruns != underrunsShown ||
+        status.audioOverruns != overrunsShown) {
+        audioLine.format("audio {}% full  {} underruns  {} overruns", audioFill,
+                         status.audioUnderruns, status.audioOverruns);
+        audioFillShown = audioFill;
+        underrunsShown = status.audioUnderruns;
+        overrunsShown  = status.audioOverruns;
+    }
+
+    formatted = true;
+}
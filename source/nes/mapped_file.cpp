@@ -0,0 +1,94 @@
+#include "nes/mapped_file.hpp"
+
+#include <fstream>
+#include <iterator>
+
+#if defined(_WIN32)
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+using namespace nes;
+
+//
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const char *path) {
+    close();
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+            HANDLE object = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (object != nullptr) {
+                mapping = MapViewOfFile(object, FILE_MAP_READ, 0, 0, 0);
+                if (mapping != nullptr) {
+                    handle = object;
+                    length = (size_t) fileSize.QuadPart;
+                } else {
+                    CloseHandle(object);
+                }
+            }
+        }
+        CloseHandle(file);
+    }
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd >= 0) {
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void *m = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED) {
+                mapping = m;
+                length  = (size_t) info.st_size;
+            }
+        }
+        ::close(fd); // the mapping keeps its own reference to the file
+    }
+#endif
+
+    if (mapping != nullptr) {
+        bytes = static_cast<const u8 *>(mapping);
+        return true;
+    }
+
+    // not mappable (empty, a pipe, ...), read it instead
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream.good()) {
+        return false;
+    }
+    fallback.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+
+    bytes  = fallback.data();
+    length = fallback.size();
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapping != nullptr) {
+#if defined(_WIN32)
+        UnmapViewOfFile(mapping);
+        CloseHandle(handle);
+#else
+        munmap(mapping, length);
+#endif
+    }
+
+    mapping = nullptr;
+    handle  = nullptr;
+    bytes   = nullptr;
+    length  = 0;
+    fallback.clear();
+}
@@ -0,0 +1,199 @@
+#include "nes/mapper.hpp"
+#include "nes/mappers/cnrom.hpp"
+#include "nes/mappers/mmc1.hpp"
+#include "nes/mappers/mmc3.hpp"
+#include "nes/mappers/nrom.hpp"
+#include "nes/mappers/uxrom.hpp"
+
+#include "common/log.hpp"
+
+#include <algorithm>
+
+using namespace nes;
+
+//
+
+static constexpr u8 PRG_RAM_FIRST_PAGE = 0x60;
+static constexpr u8 PRG_RAM_PAGE_COUNT = 0x20;
+static constexpr u8 PRG_ROM_FIRST_PAGE = 0x80;
+
+static constexpr u32 PAGE_SIZE = 256;
+
+static constexpr u32 TRAINER_OFFSET = 0x1000; // $7000
+
+//
+
+std::unique_ptr<Mapper> Mapper::create(const Rom *rom) {
+    switch (rom->get_mapper_id()) {
+    case 0:
+        return std::make_unique<Nrom>(rom);
+    case 1:
+        return std::make_unique<Mmc1>(rom);
+    case 2:
+        return std::make_unique<Uxrom>(rom);
+    case 3:
+        return std::make_unique<Cnrom>(rom);
+    case 4:
+        return std::make_unique<Mmc3>(rom);
+    default:
+        log_message(log_ERROR, "Unsupported mapper. MapperID: {}", rom->get_mapper_id());
+        return nullptr;
+    }
+}
+
+Mapper::Mapper(const Rom *r) : rom(r) {
+    prgBankMask = rom->get_prg_size() / PRG_BANK_SIZE - 1;
+    chrBankMask = rom->get_chr_size() / CHR_BANK_SIZE - 1;
+
+    prgRam.resize(rom->get_prg_ram_size());
+
+    if (rom->has_chr_ram()) {
+        chrRam.resize(rom->get_chr_size());
+        chrData = chrRam.data();
+    } else {
+        chrData = rom->get_chr_data();
+    }
+}
+
+void Mapper::attach(Bus *b, Ppu *p, Cpu *c, Scheduler *s) {
+    bus       = b;
+    ppu       = p;
+    cpu       = c;
+    scheduler = s;
+
+    bus->attach_cartridge({read_cartridge, write_cartridge, this});
+
+    // without PRG RAM $6000-$7FFF stays unmapped, reads are open bus
+    if (!prgRam.empty()) {
+        if (const u8 *trainer = rom->get_trainer()) {
+            std::copy_n(trainer, Rom::TRAINER_SIZE, &prgRam[TRAINER_OFFSET]);
+        }
+
+        // the Rom keeps the size a power of two of whole pages
+        for (u32 i = 0; i < PRG_RAM_PAGE_COUNT; i++) {
+            u8 *page = &prgRam[(i * PAGE_SIZE) & (prgRam.size() - 1)];
+            bus->map_page(PRG_RAM_FIRST_PAGE + i, page, page);
+        }
+    }
+
+    // only mappers with a scanline counter get the event, a previous cartridge may have had one
+    scheduler->set_handler(ev_MAPPER, nullptr, nullptr);
+    scheduler->cancel(ev_MAPPER);
+    cpu->set_irq_line(irq_MAPPER, false);
+
+    set_mirroring(rom->get_mirroring());
+    power_on();
+}
+
+void Mapper::save_state(State &state) const {
+    state.registers = {};
+    save_registers(state.registers.data());
+}
+
+void Mapper::load_state(const State &state) {
+    load_registers(state.registers.data());
+}
+
+//
+
+u8 Mapper::read_cartridge(void *, u16 address) {
+    // nothing on the cartridge answers here, PRG RAM and ROM are mapped straight into the bus.
+    // this is open bus, e.g. $6000-$7FFF on a cartridge without PRG RAM
+    log_hot_path_warning("Read from unmapped cartridge address 0x{:04x}", address);
+    return 0;
+}
+
+void Mapper::write_cartridge(void *context, u16 address, u8 data) {
+    if (address >= 0x8000) {
+        static_cast<Mapper *>(context)->write_register(address, data);
+    } else {
+        log_hot_path_warning("Write to unmapped cartridge address 0x{:04x}", address);
+    }
+}
+
+//
+
+void Mapper::map_prg_8k(u32 slot, u32 bank) {
+    const u8 *base = rom->get_prg_data() + (bank & prgBankMask) * PRG_BANK_SIZE;
+    u8 first       = PRG_ROM_FIRST_PAGE + slot * (PRG_BANK_SIZE / PAGE_SIZE);
+
+    if (bus->get_read_page(first) == base) {
+        return;
+    }
+
+    for (u32 i = 0; i < PRG_BANK_SIZE / PAGE_SIZE; i++) {
+        bus->map_page(first + i, base + i * PAGE_SIZE, nullptr);
+    }
+
+    // the running batch may have decoded instructions from the old bank ahead of the cpu
+    scheduler->interrupt_batch();
+}
+
+void Mapper::map_prg_16k(u32 slot, u32 bank) {
+    map_prg_8k(slot * 2 + 0, bank * 2 + 0);
+    map_prg_8k(slot * 2 + 1, bank * 2 + 1);
+}
+
+void Mapper::map_prg_32k(u32 bank) {
+    map_prg_16k(0, bank * 2 + 0);
+    map_prg_16k(1, bank * 2 + 1);
+}
+
+void Mapper::map_chr_1k(u32 slot, u32 bank) {
+    u32 offset = (bank & chrBankMask) * CHR_BANK_SIZE;
+    u8 *ram    = get_chr_ram();
+    ppu->map_chr_page(slot, chrData + offset, ram != nullptr ? ram + offset : nullptr);
+}
+
+void Mapper::map_chr_2k(u32 slot, u32 bank) {
+    map_chr_1k(slot * 2 + 0, bank * 2 + 0);
+    map_chr_1k(slot * 2 + 1, bank * 2 + 1);
+}
+
+void Mapper::map_chr_4k(u32 slot, u32 bank) {
+    map_chr_2k(slot * 2 + 0, bank * 2 + 0);
+    map_chr_2k(slot * 2 + 1, bank * 2 + 1);
+}
+
+void Mapper::map_chr_8k(u32 bank) {
+    map_chr_4k(0, bank * 2 + 0);
+    map_chr_4k(1, bank * 2 + 1);
+}
+
+void Mapper::set_mirroring(Rom::ScreenMirroring mirroring) {
+    // four screen cartridges bring their own nametable RAM, the mapper can't change that
+    if (rom->get_mirroring() == Rom::sm_FOUR_SCREEN) {
+        mirroring = Rom::sm_FOUR_SCREEN;
+    }
+    ppu->set_mirroring(mirroring);
+}
+
+void Mapper::set_irq(bool asserted) {
+    cpu->set_irq_line(irq_MAPPER, asserted);
+}
+
+//
+
+void Mapper::enable_scanline_counter() {
+    scheduler->set_handler(ev_MAPPER, on_scanline_counter, this);
+
+    u64 next = ppu->get_line_timestamp() +
+               SCANLINE_COUNTER_DOT * Scheduler::MASTER_CYCLES_PER_PPU_DOT;
+    if (next < scheduler->now()) {
+        next += Ppu::MASTER_CYCLES_PER_SCANLINE;
+    }
+    scheduler->schedule(ev_MAPPER, next);
+}
+
+void Mapper::on_scanline_counter(void *context, u64 timestamp) {
+    auto mapper = static_cast<Mapper *>(context);
+
+    // the ppu line event at dot 0 has already fired, so the ppu is on the line being clocked
+    u32 line     = mapper->ppu->get_scanline();
+    bool counted = line < Ppu::SCREEN_HEIGHT || line == Ppu::SCANLINES_PER_FRAME - 1;
+    if (counted && mapper->ppu->rendering_enabled()) {
+        mapper->clock_scanline();
+    }
+
+    mapper->scheduler->schedule(ev_MAPPER, timestamp + Ppu::MASTER_CYCLES_PER_SCANLINE);
+}
@@ -0,0 +1,26 @@
+#include "nes/mappers/cnrom.hpp"
+
+using namespace nes;
+
+//
+
+void Cnrom::power_on() {
+    map_prg_16k(0, 0);
+    map_prg_16k(1, 1);
+    chrBank = 0;
+    map_chr_8k(chrBank);
+}
+
+void Cnrom::write_register(u16, u8 data) {
+    chrBank = data;
+    map_chr_8k(chrBank);
+}
+
+void Cnrom::save_registers(u8 *data) const {
+    data[0] = chrBank;
+}
+
+void Cnrom::load_registers(const u8 *data) {
+    chrBank = data[0];
+    map_chr_8k(chrBank);
+}
@@ -0,0 +1,110 @@
+#include "nes/mappers/mmc1.hpp"
+
+#include <algorithm>
+
+using namespace nes;
+
+//
+
+static constexpr u32 PRG_OUTER_BANK_SIZE = 16; // in 16 KiB banks, 256 KiB
+
+//
+
+void Mmc1::power_on() {
+    shift    = 0x10;
+    control  = 0x0C;
+    chrBank0 = 0;
+    chrBank1 = 0;
+    prgBank  = 0;
+    update_banks();
+}
+
+void Mmc1::write_register(u16 address, u8 data) {
+    if (data & 0x80) {
+        // reset the shift register and go back to the fixed last bank layout
+        shift = 0x10;
+        control |= 0x0C;
+        update_banks();
+        return;
+    }
+
+    bool full = (shift & 0x01) != 0;
+    shift     = (shift >> 1) | ((data & 0x01) << 4);
+    if (!full) {
+        return;
+    }
+
+    switch ((address >> 13) & 0x03) {
+    case 0:
+        control = shift;
+        break;
+    case 1:
+        chrBank0 = shift;
+        break;
+    case 2:
+        chrBank1 = shift;
+        break;
+    case 3:
+        prgBank = shift;
+        break;
+    }
+
+    shift = 0x10;
+    update_banks();
+}
+
+//
+
+void Mmc1::update_banks() {
+    static constexpr Rom::ScreenMirroring MIRRORING[] = {
+        Rom::sm_SINGLE_SCREEN, Rom::sm_SINGLE_SCREEN_UPPER, Rom::sm_VERTICAL, Rom::sm_HORIZONTAL};
+    set_mirroring(MIRRORING[control & 0x03]);
+
+    // PRG, in 16 KiB banks within a 256 KiB window
+    u32 banks = get_prg_bank_count() / 2;
+    u32 outer = banks > PRG_OUTER_BANK_SIZE ? (chrBank0 & 0x10) : 0;
+    u32 last  = std::min(banks, PRG_OUTER_BANK_SIZE) - 1;
+    u32 bank  = prgBank & 0x0F;
+
+    switch ((control >> 2) & 0x03) {
+    case 0:
+    case 1:
+        map_prg_32k((outer + bank) >> 1);
+        break;
+    case 2:
+        map_prg_16k(0, outer);
+        map_prg_16k(1, outer + bank);
+        break;
+    case 3:
+        map_prg_16k(0, outer + bank);
+        map_prg_16k(1, outer + last);
+        break;
+    }
+
+    // CHR
+    if (control & 0x10) {
+        map_chr_4k(0, chrBank0);
+        map_chr_4k(1, chrBank1);
+    } else {
+        map_chr_8k(chrBank0 >> 1);
+    }
+}
+
+//
+
+void Mmc1::save_registers(u8 *data) const {
+    data[0] = shift;
+    data[1] = control;
+    data[2] = chrBank0;
+    data[3] = chrBank1;
+    data[4] = prgBank;
+}
+
+void Mmc1::load_registers(const u8 *data) {
+    shift    = data[0];
+    control  = data[1];
+    chrBank0 = data[2];
+    chrBank1 = data[3];
+    prgBank  = data[4];
+    update_banks();
+}
@@ -0,0 +1,116 @@
+#include "nes/mappers/mmc3.hpp"
+
+#include <algorithm>
+
+using namespace nes;
+
+//
+
+void Mmc3::power_on() {
+    bankSelect = 0;
+    banks      = {0, 2, 4, 5, 6, 7, 0, 1};
+
+    irqLatch   = 0;
+    irqCounter = 0;
+    irqReload  = false;
+    irqEnabled = false;
+
+    update_banks();
+    enable_scanline_counter();
+}
+
+void Mmc3::write_register(u16 address, u8 data) {
+    // registers are selected by the 8 KiB region and whether the address is even or odd
+    switch (address & 0xE001) {
+    case 0x8000:
+        bankSelect = data;
+        update_banks();
+        break;
+    case 0x8001:
+        banks[bankSelect & 0x07] = data;
+        update_banks();
+        break;
+    case 0xA000:
+        set_mirroring((data & 0x01) ? Rom::sm_HORIZONTAL : Rom::sm_VERTICAL);
+        break;
+    case 0xA001:
+        // PRG RAM protect, not emulated
+        break;
+    case 0xC000:
+        irqLatch = data;
+        break;
+    case 0xC001:
+        irqCounter = 0;
+        irqReload  = true;
+        break;
+    case 0xE000:
+        irqEnabled = false;
+        set_irq(false);
+        break;
+    case 0xE001:
+        irqEnabled = true;
+        break;
+    }
+}
+
+void Mmc3::clock_scanline() {
+    if (irqCounter == 0 || irqReload) {
+        irqCounter = irqLatch;
+        irqReload  = false;
+    } else {
+        irqCounter--;
+    }
+
+    if (irqCounter == 0 && irqEnabled) {
+        set_irq(true);
+    }
+}
+
+//
+
+void Mmc3::update_banks() {
+    u32 secondLast = get_prg_bank_count() - 2;
+
+    // PRG mode swaps the switchable bank at $8000 with the fixed second last bank at $C000
+    if (bankSelect & 0x40) {
+        map_prg_8k(0, secondLast);
+        map_prg_8k(2, banks[6]);
+    } else {
+        map_prg_8k(0, banks[6]);
+        map_prg_8k(2, secondLast);
+    }
+    map_prg_8k(1, banks[7]);
+    map_prg_8k(3, secondLast + 1);
+
+    // CHR A12 inversion swaps the 2 KiB banks at $0000 with the 1 KiB banks at $1000
+    bool inverted = (bankSelect & 0x80) != 0;
+    u32 slot2k    = inverted ? 2 : 0;
+    u32 slot1k    = inverted ? 0 : 4;
+
+    map_chr_2k(slot2k + 0, banks[0] >> 1);
+    map_chr_2k(slot2k + 1, banks[1] >> 1);
+    for (u32 i = 0; i < 4; i++) {
+        map_chr_1k(slot1k + i, banks[2 + i]);
+    }
+}
+
+//
+
+void Mmc3::save_registers(u8 *data) const {
+    data[0] = bankSelect;
+    std::copy(banks.begin(), banks.end(), &data[1]);
+    data[9]  = irqLatch;
+    data[10] = irqCounter;
+    data[11] = irqReload;
+    data[12] = irqEnabled;
+}
+
+void Mmc3::load_registers(const u8 *data) {
+    bankSelect = data[0];
+    std::copy_n(&data[1], banks.size(), banks.begin());
+    irqLatch   = data[9];
+    irqCounter = data[10];
+    irqReload  = data[11] != 0;
+    irqEnabled = data[12] != 0;
+    update_banks();
+}
@@ -0,0 +1,20 @@
+#include "nes/mappers/nrom.hpp"
+
+using namespace nes;
+
+//
+
+void Nrom::power_on() {
+    // a 16 KiB PRG ROM is mirrored into both halves
+    map_prg_16k(0, 0);
+    map_prg_16k(1, 1);
+    map_chr_8k(0);
+}
+
+void Nrom::write_register(u16, u8) {
+    // no registers
+}
+
+void Nrom::save_registers(u8 *) const {}
+
+void Nrom::load_registers(const u8 *) {}
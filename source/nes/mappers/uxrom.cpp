@@ -0,0 +1,26 @@
+#include "nes/mappers/uxrom.hpp"
+
+using namespace nes;
+
+//
+
+void Uxrom::power_on() {
+    prgBank = 0;
+    map_prg_16k(0, prgBank);
+    map_prg_16k(1, get_prg_bank_count() / 2 - 1);
+    map_chr_8k(0);
+}
+
+void Uxrom::write_register(u16, u8 data) {
+    prgBank = data;
+    map_prg_16k(0, prgBank);
+}
+
+void Uxrom::save_registers(u8 *data) const {
+    data[0] = prgBank;
+}
+
+void Uxrom::load_registers(const u8 *data) {
+    prgBank = data[0];
+    map_prg_16k(0, prgBank);
+}
@@ -0,0 +1,201 @@
+#include "nes/movie.hpp"
+
+#include "common/crc32.hpp"
+#include "common/log.hpp"
+
+#include <cstring>
+#include <fstream>
+
+using namespace nes;
+
+//
+
+static constexpr std::array<char, 4> MOVIE_MAGIC = {'N', 'E', 'S', 'M'};
+
+/// Start of a movie file. It is followed by the start state, the input runs and the checkpoint
+/// hashes
+struct MovieHeader {
+    std::array<char, 4> magic; // "NESM"
+    u32 version;
+    u32 romCrc32;
+    u32 frameCount;
+    u32 checkpointInterval;
+    u32 stateSize;
+    u32 runCount;
+    u32 checkpointCount;
+};
+
+/// frames with the same buttons on both ports
+struct InputRun {
+    u16 length;
+    std::array<u8, 2> buttons;
+};
+
+static constexpr u32 MAX_RUN_LENGTH = 0xFFFF;
+
+//
+
+bool Movie::save(const std::string &filepath) const {
+    std::vector<InputRun> runs;
+    for (const auto &buttons : input) {
+        if (runs.empty() || runs.back().buttons != buttons ||
+            runs.back().length == MAX_RUN_LENGTH) {
+            runs.push_back({0, buttons});
+        }
+        runs.back().length++;
+    }
+
+    MovieHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic              = MOVIE_MAGIC;
+    header.version            = MOVIE_VERSION;
+    header.romCrc32           = romCrc32;
+    header.frameCount         = (u32) input.size();
+    header.checkpointInterval = checkpointInterval;
+    header.stateSize          = (u32) startState.size();
+    header.runCount           = (u32) runs.size();
+    header.checkpointCount    = (u32) checkpoints.size();
+
+    std::ofstream file(filepath, std::ios::binary);
+    file.write((const char *) &header, sizeof(header));
+    file.write((const char *) startState.data(), startState.size());
+    file.write((const char *) runs.data(), runs.size() * sizeof(InputRun));
+    file.write((const char *) checkpoints.data(), checkpoints.size() * sizeof(u32));
+    if (!file) {
+        log_message(log_ERROR, "Failed to write movie: {}", filepath);
+        return false;
+    }
+    return true;
+}
+
+bool Movie::load(const std::string &filepath, const Core &core) {
+    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+    u64 fileSize = file ? (u64) file.tellg() : 0;
+    file.seekg(0);
+
+    MovieHeader header;
+    file.read((char *) &header, sizeof(header));
+    if (!file || header.magic != MOVIE_MAGIC || header.version != MOVIE_VERSION ||
+        header.checkpointInterval == 0) {
+        log_message(log_ERROR, "Not a movie of this version: {}", filepath);
+        return false;
+    }
+    if (header.stateSize != core.get_save_state_size()) {
+        log_message(log_ERROR, "Movie start state doesn't fit the loaded rom: {}", filepath);
+        return false;
+    }
+
+    // the counts come from the file, so they are checked against its size before anything is
+    // allocated for them
+    u64 bodySize = (u64) header.stateSize + (u64) header.runCount * sizeof(InputRun) +
+                   (u64) header.checkpointCount * sizeof(u32);
+    if (bodySize != fileSize - sizeof(header)) {
+        log_message(log_ERROR, "Movie file size doesn't match its header: {}", filepath);
+        return false;
+    }
+    if (header.checkpointCount != header.frameCount / header.checkpointInterval) {
+        log_message(log_ERROR, "Movie checkpoints don't match its frame count: {}", filepath);
+        return false;
+    }
+    if (header.frameCount > (u64) header.runCount * MAX_RUN_LENGTH) {
+        log_message(log_ERROR, "Movie input doesn't match its frame count: {}", filepath);
+        return false;
+    }
+
+    std::vector<InputRun> runs(header.runCount);
+    startState.resize(header.stateSize);
+    checkpoints.resize(header.checkpointCount);
+    file.read((char *) startState.data(), startState.size());
+    file.read((char *) runs.data(), runs.size() * sizeof(InputRun));
+    file.read((char *) checkpoints.data(), checkpoints.size() * sizeof(u32));
+    if (!file) {
+        log_message(log_ERROR, "Movie file is truncated: {}", filepath);
+        return false;
+    }
+
+    input.clear();
+    input.reserve(header.frameCount);
+    for (const auto &run : runs) {
+        input.insert(input.end(), run.length, run.buttons);
+    }
+    if (input.size() != header.frameCount) {
+        log_message(log_ERROR, "Movie input doesn't match its frame count: {}", filepath);
+        return false;
+    }
+
+    romCrc32           = header.romCrc32;
+    checkpointInterval = header.checkpointInterval;
+    return true;
+}
+
+u32 Movie::hash_state(const Core &core, u32 hash) {
+    hash = crc32(core.mem.data(), Mem::MEM_SIZE_BYTES, hash);
+    return crc32(core.ppu.get_frame(), Ppu::SCREEN_WIDTH * Ppu::SCREEN_HEIGHT, hash);
+}
+
+//
+
+MovieRecorder::MovieRecorder(Core &core, Movie &movie, u32 checkpointInterval)
+    : core(core), movie(movie) {
+    movie.romCrc32           = core.rom ? core.rom->get_crc32() : 0;
+    movie.checkpointInterval = checkpointInterval > 0 ? checkpointInterval : 1;
+    movie.startState.resize(core.get_save_state_size());
+    core.save_state(movie.startState.data(), movie.startState.size());
+    movie.input.clear();
+    movie.checkpoints.clear();
+}
+
+void MovieRecorder::run_frame(u8 port1, u8 port2) {
+    core.controllers.set_buttons(0, port1);
+    core.controllers.set_buttons(1, port2);
+    core.run_frame();
+
+    movie.input.push_back({port1, port2});
+    if (movie.input.size() % movie.checkpointInterval == 0) {
+        hash = Movie::hash_state(core, hash);
+        movie.checkpoints.push_back(hash);
+    }
+}
+
+//
+
+ReplayResult nes::replay_movie(Core &core, const Movie &movie) {
+    ReplayResult result = {false, 0, 0, 0};
+
+    if (!core.rom || core.rom->get_crc32() != movie.romCrc32) {
+        log_message(log_ERROR, "Movie was recorded with a different rom");
+        return result;
+    }
+    if (!core.load_state(movie.startState.data(), movie.startState.size())) {
+        log_message(log_ERROR, "Movie start state doesn't load");
+        return result;
+    }
+    if (movie.checkpointInterval == 0 ||
+        movie.checkpoints.size() != movie.input.size() / movie.checkpointInterval) {
+        log_message(log_ERROR, "Movie checkpoints don't match its frame count");
+        return result;
+    }
+
+    // only hash at checkpoints, replay speed is bound by the emulation alone
+    u32 hash = 0;
+    for (const auto &buttons : movie.input) {
+        core.controllers.set_buttons(0, buttons[0]);
+        core.controllers.set_buttons(1, buttons[1]);
+        core.run_frame();
+        result.frames++;
+
+        if (result.frames % movie.checkpointInterval == 0 &&
+            result.checkpoints < movie.checkpoints.size()) {
+            hash = Movie::hash_state(core, hash);
+            if (hash != movie.checkpoints[result.checkpoints]) {
+                result.mismatchFrame = result.frames;
+                return result;
+            }
+            result.checkpoints++;
+        }
+    }
+
+    // a movie only passes if every frame it covers was checked
+    result.ok = result.checkpoints == movie.checkpoints.size();
+    return result;
+}
@@ -0,0 +1,501 @@
+#include "nes/ppu.hpp"
+#include "nes/ppu_composite.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace nes;
+
+//
+
+/// colours of the 2C02 palette, 0xRRGGBB
+static constexpr u32 NTSC_PALETTE[64] = {
+    0x666666, 0x002A88, 0x1412A7, 0x3B00A4, 0x5C007E, 0x6E0040, 0x6C0600, 0x561D00,
+    0x333500, 0x0B4800, 0x005200, 0x004F08, 0x00404D, 0x000000, 0x000000, 0x000000,
+    0xADADAD, 0x155FD9, 0x4240FF, 0x7527FE, 0xA01ACC, 0xB71E7B, 0xB53120, 0x994E00,
+    0x6B6D00, 0x388700, 0x0C9300, 0x008F32, 0x007C8D, 0x000000, 0x000000, 0x000000,
+    0xFFFEFF, 0x64B0FF, 0x9290FF, 0xC676FF, 0xF36AFF, 0xFE6ECC, 0xFE8170, 0xEA9E22,
+    0xBCBE00, 0x88D800, 0x5CE430, 0x45E082, 0x48CDDE, 0x4F4F4F, 0x000000, 0x000000,
+    0xFFFEFF, 0xC0DFFF, 0xD3D2FF, 0xE8C8FF, 0xFBC2FF, 0xFEC4EA, 0xFECCC5, 0xF7D8A5,
+    0xE4E594, 0xCFEF96, 0xBDF4AB, 0xB3F3CC, 0xB5EBF2, 0xB8B8B8, 0x000000, 0x000000,
+};
+
+/// every byte of a tile row expanded to 8 bytes, one per pixel, holding that pixel's bit.
+/// built through a byte array so the pixel order in memory is left to right on any host
+static std::array<u64, 256> make_tile_expand_lookup(bool flipped) {
+    std::array<u64, 256> lookup;
+    for (u32 b = 0; b < 256; b++) {
+        u8 px[8];
+        for (u32 i = 0; i < 8; i++) {
+            px[i] = (b >> (flipped ? i : 7 - i)) & 1;
+        }
+        std::memcpy(&lookup[b], px, sizeof(px));
+    }
+    return lookup;
+}
+
+/// rgba colour for every emphasis setting (PPUMASK bits 5-7) and palette index
+static std::array<std::array<u32, 64>, 8> make_rgba_lookup() {
+    std::array<std::array<u32, 64>, 8> lookup;
+    for (u32 emphasis = 0; emphasis < 8; emphasis++) {
+        for (u32 i = 0; i < 64; i++) {
+            float r = (NTSC_PALETTE[i] >> 16) & 0xFF;
+            float g = (NTSC_PALETTE[i] >> 8) & 0xFF;
+            float b = NTSC_PALETTE[i] & 0xFF;
+
+            // emphasising a colour darkens the other two
+            if (emphasis & 0x01) { g *= 0.75f; b *= 0.75f; }
+            if (emphasis & 0x02) { r *= 0.75f; b *= 0.75f; }
+            if (emphasis & 0x04) { r *= 0.75f; g *= 0.75f; }
+
+            u8 rgba[4] = {(u8) r, (u8) g, (u8) b, 0xFF};
+            std::memcpy(&lookup[emphasis][i], rgba, sizeof(rgba));
+        }
+    }
+    return lookup;
+}
+
+static const std::array<u64, 256> TILE_EXPAND_LOOKUP         = make_tile_expand_lookup(false);
+static const std::array<u64, 256> TILE_EXPAND_FLIPPED_LOOKUP = make_tile_expand_lookup(true);
+
+static const std::array<std::array<u32, 64>, 8> RGBA_LOOKUP = make_rgba_lookup();
+
+/// picked once for the running cpu
+static const CompositeKernel COMPOSITE_KERNEL = get_best_composite_kernel();
+
+/// backing for unmapped pattern table pages
+static const u8 OPEN_CHR_PAGE[0x400] = {};
+
+//
+
+static constexpr u8 STATUS_OVERFLOW = 0x20;
+static constexpr u8 STATUS_SPRITE_0 = 0x40;
+static constexpr u8 STATUS_VBLANK   = 0x80;
+
+static constexpr u32 VBLANK_SCANLINE    = 241;
+static constexpr u32 PRERENDER_SCANLINE = 261;
+
+//
+
+Ppu::Ppu() {
+    for (u8 page = 0; page < 8; page++) {
+        map_chr_page(page, OPEN_CHR_PAGE, nullptr);
+    }
+    set_mirroring(Rom::sm_HORIZONTAL);
+}
+
+void Ppu::attach(Scheduler *s) {
+    scheduler = s;
+    scheduler->set_handler(ev_PPU_SCANLINE, on_scanline, this);
+
+    // start at the pre-render line so the next scanline is the first visible one
+    scanline      = PRERENDER_SCANLINE;
+    lineTimestamp = scheduler->now();
+    scheduler->schedule(ev_PPU_SCANLINE, lineTimestamp);
+}
+
+void Ppu::reset() {
+    ctrl       = 0;
+    mask       = 0;
+    w          = false;
+    readBuffer = 0;
+}
+
+void Ppu::save_state(State &state) const {
+    state.ctrl          = ctrl;
+    state.mask          = mask;
+    state.status        = status;
+    state.oamAddr       = oamAddr;
+    state.v             = v;
+    state.t             = t;
+    state.fineX         = fineX;
+    state.w             = w;
+    state.readBuffer    = readBuffer;
+    state.latch         = latch;
+    state.mirroring     = mirroring;
+    state.scanline      = scanline;
+    state.lineTimestamp = lineTimestamp;
+    state.frameCount    = frameCount;
+    state.vram          = vram;
+    state.palette       = palette;
+    state.oam           = oam;
+}
+
+void Ppu::load_state(const State &state) {
+    ctrl          = state.ctrl;
+    mask          = state.mask;
+    status        = state.status;
+    oamAddr       = state.oamAddr;
+    v             = state.v;
+    t             = state.t;
+    fineX         = state.fineX;
+    w             = state.w;
+    readBuffer    = state.readBuffer;
+    latch         = state.latch;
+    scanline      = state.scanline;
+    lineTimestamp = state.lineTimestamp;
+    frameCount    = state.frameCount;
+    vram          = state.vram;
+    palette       = state.palette;
+    oam           = state.oam;
+
+    set_mirroring(state.mirroring);
+}
+
+void Ppu::map_chr_page(u8 page, const u8 *read, u8 *write) {
+    chrPages[page]      = read;
+    chrWritePages[page] = write;
+}
+
+void Ppu::set_mirroring(Rom::ScreenMirroring m) {
+    static constexpr u8 LAYOUTS[][4] = {
+        {0, 0, 1, 1}, // horizontal
+        {0, 1, 0, 1}, // vertical
+        {0, 1, 2, 3}, // four screen
+        {0, 0, 0, 0}, // single screen, first nametable
+        {1, 1, 1, 1}, // single screen, second nametable
+    };
+
+    mirroring = m;
+
+    const u8 *layout;
+    switch (mirroring) {
+    case Rom::sm_VERTICAL:
+        layout = LAYOUTS[1];
+        break;
+    case Rom::sm_FOUR_SCREEN:
+        layout = LAYOUTS[2];
+        break;
+    case Rom::sm_SINGLE_SCREEN:
+        layout = LAYOUTS[3];
+        break;
+    case Rom::sm_SINGLE_SCREEN_UPPER:
+        layout = LAYOUTS[4];
+        break;
+    default:
+        layout = LAYOUTS[0];
+        break;
+    }
+
+    for (u32 i = 0; i < 4; i++) {
+        nametables[i] = &vram[layout[i] * 0x400];
+    }
+}
+
+//
+
+u8 Ppu::read_register(u16 address) {
+    switch (address & 0x07) {
+    case 2: { // PPUSTATUS
+        u8 data = (status & 0xE0) | (latch & 0x1F);
+        status &= ~STATUS_VBLANK;
+        w = false;
+        return data;
+    }
+    case 4: // OAMDATA
+        return oam[oamAddr];
+    case 7: { // PPUDATA
+        u8 data;
+        if ((v & 0x3FFF) < 0x3F00) {
+            data       = readBuffer;
+            readBuffer = read_vram(v);
+        } else {
+            // palette reads are not buffered, the buffer gets the nametable byte underneath
+            data       = read_vram(v);
+            readBuffer = read_vram(v - 0x1000);
+        }
+        v += (ctrl & 0x04) ? 32 : 1;
+        return data;
+    }
+    default: // write only registers
+        return latch;
+    }
+}
+
+void Ppu::write_register(u16 address, u8 data) {
+    latch = data;
+
+    switch (address & 0x07) {
+    case 0: { // PPUCTRL
+        bool nmiEnabled = (ctrl & 0x80) != 0;
+        ctrl            = data;
+        t               = (t & 0xF3FF) | ((data & 0x03) << 10);
+
+        // enabling NMI while in vblank triggers it right away
+        if (!nmiEnabled && (ctrl & 0x80) && (status & STATUS_VBLANK)) {
+            scheduler->schedule(ev_NMI, scheduler->now());
+        }
+        break;
+    }
+    case 1: // PPUMASK
+        mask = data;
+        break;
+    case 3: // OAMADDR
+        oamAddr = data;
+        break;
+    case 4: // OAMDATA
+        oam[oamAddr] = data;
+        oamAddr++;
+        break;
+    case 5: // PPUSCROLL
+        if (!w) {
+            t     = (t & 0xFFE0) | (data >> 3);
+            fineX = data & 0x07;
+        } else {
+            t = (t & 0x8C1F) | ((data & 0xF8) << 2) | ((data & 0x07) << 12);
+        }
+        w = !w;
+        break;
+    case 6: // PPUADDR
+        if (!w) {
+            t = (t & 0x00FF) | ((data & 0x3F) << 8);
+        } else {
+            t = (t & 0xFF00) | data;
+            v = t;
+        }
+        w = !w;
+        break;
+    case 7: // PPUDATA
+        write_vram(v, data);
+        v += (ctrl & 0x04) ? 32 : 1;
+        break;
+    default: // PPUSTATUS is read only
+        break;
+    }
+}
+
+void Ppu::write_oam_dma(const u8 *data) {
+    size_t first = oam.size() - oamAddr;
+    std::memcpy(&oam[oamAddr], data, first);
+    std::memcpy(&oam[0], data + first, oamAddr);
+}
+
+//
+
+/// palette address, $3F10/$3F14/$3F18/$3F1C mirror the background entries
+static inline u8 palette_index(u16 address) {
+    u8 index = address & 0x1F;
+    return (index & 0x13) == 0x10 ? index & 0x0F : index;
+}
+
+u8 Ppu::read_vram(u16 address) {
+    address &= 0x3FFF;
+    if (address < 0x2000) {
+        return read_chr(address);
+    } else if (address < 0x3F00) {
+        return nametable_at(address);
+    } else {
+        return palette[palette_index(address)];
+    }
+}
+
+void Ppu::write_vram(u16 address, u8 data) {
+    address &= 0x3FFF;
+    if (address < 0x2000) {
+        if (u8 *page = chrWritePages[address >> 10]) {
+            page[address & 0x3FF] = data;
+        }
+    } else if (address < 0x3F00) {
+        nametable_at(address) = data;
+    } else {
+        palette[palette_index(address)] = data & 0x3F;
+    }
+}
+
+//
+
+u64 Ppu::get_next_vblank() const {
+    u32 lines = scanline < VBLANK_SCANLINE ? VBLANK_SCANLINE - scanline
+                                           : SCANLINES_PER_FRAME - scanline + VBLANK_SCANLINE;
+    return lineTimestamp + lines * MASTER_CYCLES_PER_SCANLINE;
+}
+
+void Ppu::on_scanline(void *context, u64 timestamp) {
+    auto ppu = static_cast<Ppu *>(context);
+
+    ppu->scanline      = (ppu->scanline + 1) % SCANLINES_PER_FRAME;
+    ppu->lineTimestamp = timestamp;
+
+    u32 line = ppu->scanline;
+    if (line < SCREEN_HEIGHT) {
+        ppu->render_scanline(line);
+    } else if (line == VBLANK_SCANLINE) {
+        ppu->status |= STATUS_VBLANK;
+        ppu->frameCount++;
+        if (ppu->ctrl & 0x80) {
+            // vblank flag and NMI happen on dot 1
+            ppu->scheduler->schedule(ev_NMI, timestamp + Scheduler::MASTER_CYCLES_PER_PPU_DOT);
+        }
+    } else if (line == PRERENDER_SCANLINE) {
+        ppu->status &= ~(STATUS_VBLANK | STATUS_SPRITE_0 | STATUS_OVERFLOW);
+        if (ppu->rendering_enabled()) {
+            // horizontal (dot 257) and vertical (dots 280-304) scroll copies
+            ppu->v = ppu->t;
+        }
+    }
+
+    ppu->scheduler->schedule(ev_PPU_SCANLINE, timestamp + MASTER_CYCLES_PER_SCANLINE);
+}
+
+//
+
+void Ppu::render_scanline(u32 line) {
+    u8 *out            = &output[line * SCREEN_WIDTH];
+    lineEmphasis[line] = mask >> 5;
+
+    if (!rendering_enabled()) {
+        std::fill(out, out + SCREEN_WIDTH, palette[0]);
+        return;
+    }
+
+    u8 bgPixels[SCREEN_WIDTH];
+    u8 spPixels[SCREEN_WIDTH];
+    render_layers(line, bgPixels, spPixels);
+
+    u8 bgLeftMask = (mask & 0x02) ? 0xFF : 0x00;
+    u8 spLeftMask = (mask & 0x04) ? 0xFF : 0x00;
+    u8 greyscale  = (mask & 0x01) ? 0x30 : 0x3F;
+
+    if (COMPOSITE_KERNEL(bgPixels, spPixels, palette.data(), bgLeftMask, spLeftMask, greyscale,
+                         out)) {
+        status |= STATUS_SPRITE_0;
+    }
+
+    // increment fine / coarse y (dot 256)
+    if ((v & 0x7000) != 0x7000) {
+        v += 0x1000;
+    } else {
+        v &= ~0x7000;
+        u16 coarseY = (v & 0x03E0) >> 5;
+        if (coarseY == 29) {
+            coarseY = 0;
+            v ^= 0x0800; // switch vertical nametable
+        } else if (coarseY == 31) {
+            coarseY = 0; // out of bounds, wraps without switching nametables
+        } else {
+            coarseY++;
+        }
+        v = (v & ~0x03E0) | (coarseY << 5);
+    }
+
+    // copy horizontal scroll bits from t (dot 257)
+    v = (v & ~0x041F) | (t & 0x041F);
+}
+
+void Ppu::render_layers(u32 line, u8 *bgPixels, u8 *spPixels) {
+    std::fill(bgPixels, bgPixels + SCREEN_WIDTH, 0);
+    std::fill(spPixels, spPixels + SCREEN_WIDTH, 0);
+
+    if (mask & 0x08) {
+        render_background(bgPixels);
+    }
+    if (mask & 0x10) {
+        render_sprites(line, spPixels);
+    }
+}
+
+void Ppu::render_background(u8 *pixels) {
+    // 33 tiles so the line is still covered after shifting by fine x
+    u8 line[33 * 8];
+
+    u16 addr        = v;
+    u16 fineY       = (v >> 12) & 0x07;
+    u16 patternBase = (ctrl & 0x10) ? 0x1000 : 0x0000;
+
+    for (u32 tile = 0; tile < 33; tile++) {
+        u8 index     = nametable_at(0x2000 | (addr & 0x0FFF));
+        u8 attribute = nametable_at(0x23C0 | (addr & 0x0C00) | ((addr >> 4) & 0x38) |
+                                    ((addr >> 2) & 0x07));
+        u8 shift     = ((addr >> 4) & 0x04) | (addr & 0x02);
+
+        // palette select in bits 2-3 of every pixel
+        u64 paletteBits = (u64) (((attribute >> shift) & 0x03) << 2) * 0x0101010101010101ULL;
+
+        u16 pattern = patternBase + index * 16 + fineY;
+        u64 row     = TILE_EXPAND_LOOKUP[read_chr(pattern)] |
+                      (TILE_EXPAND_LOOKUP[read_chr(pattern + 8)] << 1);
+
+        row |= paletteBits;
+        std::memcpy(&line[tile * 8], &row, sizeof(row));
+
+        // increment coarse x, switching horizontal nametable on wrap
+        if ((addr & 0x001F) == 31) {
+            addr &= ~0x001F;
+            addr ^= 0x0400;
+        } else {
+            addr++;
+        }
+    }
+
+    std::memcpy(pixels, &line[fineX], SCREEN_WIDTH);
+}
+
+void Ppu::render_sprites(u32 line, u8 *pixels) {
+    u32 height = (ctrl & 0x20) ? 16 : 8;
+    u32 count  = 0;
+
+    for (u32 i = 0; i < 64; i++) {
+        const u8 *sprite = &oam[i * 4];
+
+        // sprites are drawn one line below their y coordinate
+        int row = (int) line - sprite[0] - 1;
+        if (row < 0 || row >= (int) height) {
+            continue;
+        }
+
+        if (count == 8) {
+            status |= STATUS_OVERFLOW;
+            break;
+        }
+        count++;
+
+        u8 tile      = sprite[1];
+        u8 attribute = sprite[2];
+        u8 x         = sprite[3];
+
+        if (attribute & 0x80) {
+            row = height - 1 - row;
+        }
+
+        u16 pattern;
+        if (height == 8) {
+            pattern = ((ctrl & 0x08) ? 0x1000 : 0x0000) + tile * 16 + row;
+        } else {
+            pattern = ((tile & 0x01) ? 0x1000 : 0x0000) + (tile & 0xFE) * 16 + (row & 0x08) * 2 +
+                      (row & 0x07);
+        }
+
+        const auto &expand = (attribute & 0x40) ? TILE_EXPAND_FLIPPED_LOOKUP : TILE_EXPAND_LOOKUP;
+        u64 bits = expand[read_chr(pattern)] | (expand[read_chr(pattern + 8)] << 1);
+
+        u8 rowPixels[8];
+        std::memcpy(rowPixels, &bits, sizeof(bits));
+
+        u8 flags = 0x10 | ((attribute & 0x03) << 2) | ((attribute & 0x20) << 1) |
+                   (i == 0 ? 0x80 : 0x00);
+
+        for (u32 p = 0; p < 8 && x + p < SCREEN_WIDTH; p++) {
+            // lower OAM index wins, even if it ends up behind the background
+            if (rowPixels[p] != 0 && (pixels[x + p] & 0x03) == 0) {
+                pixels[x + p] = flags | rowPixels[p];
+            }
+        }
+    }
+}
+
+//
+
+void Ppu::set_output(u8 *buffer) {
+    output = buffer != nullptr ? buffer : frame.data();
+}
+
+void Ppu::frame_to_rgba(u32 *pixels) const {
+    for (u32 y = 0; y < SCREEN_HEIGHT; y++) {
+        const auto &lookup = RGBA_LOOKUP[lineEmphasis[y]];
+        const u8 *in       = &output[y * SCREEN_WIDTH];
+        u32 *out           = &pixels[y * SCREEN_WIDTH];
+        for (u32 x = 0; x < SCREEN_WIDTH; x++) {
+            out[x] = lookup[in[x]];
+        }
+    }
+}
@@ -0,0 +1,203 @@
+#include "nes/ppu_composite.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+  #define NES_COMPOSITE_X86 1
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+    #define NES_TARGET_AVX2
+  #else
+    #define NES_TARGET_AVX2 __attribute__((target("avx2")))
+  #endif
+#endif
+
+using namespace nes;
+
+//
+
+static constexpr u32 LINE_WIDTH = 256;
+
+static bool composite_scalar(const u8 *bg, const u8 *sp, const u8 *palette, u8 bgLeftMask,
+                             u8 spLeftMask, u8 greyscale, u8 *out) {
+    bool hit = false;
+    for (u32 x = 0; x < LINE_WIDTH; x++) {
+        u8 b = bg[x] & (x < 8 ? bgLeftMask : 0xFF);
+        u8 s = sp[x] & (x < 8 ? spLeftMask : 0xFF);
+
+        u8 address = 0;
+        if ((s & 0x03) && (b & 0x03)) {
+            if ((s & 0x80) && x != 255) {
+                hit = true;
+            }
+            address = (s & 0x40) ? b : s & 0x1F;
+        } else if (s & 0x03) {
+            address = s & 0x1F;
+        } else if (b & 0x03) {
+            address = b;
+        }
+
+        out[x] = palette[address] & greyscale;
+    }
+    return hit;
+}
+
+#ifdef NES_COMPOSITE_X86
+
+/// palette addresses for 16 pixels, palette lookup is scalar as SSE2 has no byte shuffle
+static bool composite_sse2(const u8 *bg, const u8 *sp, const u8 *palette, u8 bgLeftMask,
+                           u8 spLeftMask, u8 greyscale, u8 *out) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(-1);
+    const __m128i low2 = _mm_set1_epi8(0x03);
+    const __m128i low5 = _mm_set1_epi8(0x1F);
+    const __m128i bit6 = _mm_set1_epi8(0x40);
+    const __m128i bit7 = _mm_set1_epi8((char) 0x80);
+
+    // left 8 pixel clipping for the first chunk, x = 255 never hits for the last one
+    const __m128i bgClip  = _mm_set_epi64x(-1, (long long) (0x0101010101010101ULL * bgLeftMask));
+    const __m128i spClip  = _mm_set_epi64x(-1, (long long) (0x0101010101010101ULL * spLeftMask));
+    const __m128i lastHit = _mm_set_epi64x(0x00FFFFFFFFFFFFFFLL, -1);
+
+    int hit = 0;
+    alignas(16) u8 address[16];
+
+    for (u32 x = 0; x < LINE_WIDTH; x += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i *) (bg + x));
+        __m128i s = _mm_loadu_si128((const __m128i *) (sp + x));
+        if (x == 0) {
+            b = _mm_and_si128(b, bgClip);
+            s = _mm_and_si128(s, spClip);
+        }
+
+        __m128i bgClear = _mm_cmpeq_epi8(_mm_and_si128(b, low2), zero);
+        __m128i spClear = _mm_cmpeq_epi8(_mm_and_si128(s, low2), zero);
+        __m128i behind  = _mm_cmpeq_epi8(_mm_and_si128(s, bit6), bit6);
+        __m128i sprite0 = _mm_cmpeq_epi8(_mm_and_si128(s, bit7), bit7);
+
+        __m128i hits = _mm_andnot_si128(_mm_or_si128(bgClear, spClear), sprite0);
+        if (x == LINE_WIDTH - 16) {
+            hits = _mm_and_si128(hits, lastHit);
+        }
+        hit |= _mm_movemask_epi8(hits);
+
+        // sprite wins where it is opaque, unless it is behind an opaque background pixel
+        __m128i front  = _mm_or_si128(bgClear, _mm_xor_si128(behind, ones));
+        __m128i useSp  = _mm_andnot_si128(spClear, front);
+        __m128i bgAddr = _mm_andnot_si128(bgClear, b);
+        __m128i addr   = _mm_or_si128(_mm_and_si128(useSp, _mm_and_si128(s, low5)),
+                                      _mm_andnot_si128(useSp, bgAddr));
+
+        _mm_store_si128((__m128i *) address, addr);
+        for (u32 i = 0; i < 16; i++) {
+            out[x + i] = palette[address[i]] & greyscale;
+        }
+    }
+
+    return hit != 0;
+}
+
+/// 32 pixels at a time, palette lookup through two 16 entry byte shuffles
+NES_TARGET_AVX2
+static bool composite_avx2(const u8 *bg, const u8 *sp, const u8 *palette, u8 bgLeftMask,
+                           u8 spLeftMask, u8 greyscale, u8 *out) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi8(-1);
+    const __m256i low2 = _mm256_set1_epi8(0x03);
+    const __m256i low4 = _mm256_set1_epi8(0x0F);
+    const __m256i low5 = _mm256_set1_epi8(0x1F);
+    const __m256i bit4 = _mm256_set1_epi8(0x10);
+    const __m256i bit6 = _mm256_set1_epi8(0x40);
+    const __m256i bit7 = _mm256_set1_epi8((char) 0x80);
+    const __m256i grey = _mm256_set1_epi8((char) greyscale);
+
+    const __m256i bgClip = _mm256_set_epi64x(-1, -1, -1,
+                                             (long long) (0x0101010101010101ULL * bgLeftMask));
+    const __m256i spClip = _mm256_set_epi64x(-1, -1, -1,
+                                             (long long) (0x0101010101010101ULL * spLeftMask));
+    const __m256i lastHit = _mm256_set_epi64x(0x00FFFFFFFFFFFFFFLL, -1, -1, -1);
+
+    // the shuffle works within 128 bit lanes, so both lanes get a copy of the palette halves
+    const __m256i paletteLo =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) palette));
+    const __m256i paletteHi =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) (palette + 16)));
+
+    int hit = 0;
+
+    for (u32 x = 0; x < LINE_WIDTH; x += 32) {
+        __m256i b = _mm256_loadu_si256((const __m256i *) (bg + x));
+        __m256i s = _mm256_loadu_si256((const __m256i *) (sp + x));
+        if (x == 0) {
+            b = _mm256_and_si256(b, bgClip);
+            s = _mm256_and_si256(s, spClip);
+        }
+
+        __m256i bgClear = _mm256_cmpeq_epi8(_mm256_and_si256(b, low2), zero);
+        __m256i spClear = _mm256_cmpeq_epi8(_mm256_and_si256(s, low2), zero);
+        __m256i behind  = _mm256_cmpeq_epi8(_mm256_and_si256(s, bit6), bit6);
+        __m256i sprite0 = _mm256_cmpeq_epi8(_mm256_and_si256(s, bit7), bit7);
+
+        __m256i hits = _mm256_andnot_si256(_mm256_or_si256(bgClear, spClear), sprite0);
+        if (x == LINE_WIDTH - 32) {
+            hits = _mm256_and_si256(hits, lastHit);
+        }
+        hit |= _mm256_movemask_epi8(hits);
+
+        __m256i front  = _mm256_or_si256(bgClear, _mm256_xor_si256(behind, ones));
+        __m256i useSp  = _mm256_andnot_si256(spClear, front);
+        __m256i bgAddr = _mm256_andnot_si256(bgClear, b);
+        __m256i addr   = _mm256_or_si256(_mm256_and_si256(useSp, _mm256_and_si256(s, low5)),
+                                         _mm256_andnot_si256(useSp, bgAddr));
+
+        __m256i index  = _mm256_and_si256(addr, low4);
+        __m256i colLo  = _mm256_shuffle_epi8(paletteLo, index);
+        __m256i colHi  = _mm256_shuffle_epi8(paletteHi, index);
+        __m256i isHi   = _mm256_cmpeq_epi8(_mm256_and_si256(addr, bit4), bit4);
+        __m256i colour = _mm256_and_si256(_mm256_blendv_epi8(colLo, colHi, isHi), grey);
+
+        _mm256_storeu_si256((__m256i *) (out + x), colour);
+    }
+
+    return hit != 0;
+}
+
+static bool cpu_has_avx2() {
+  #if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x06) == 0x06;
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5)) != 0;
+  #else
+    return __builtin_cpu_supports("avx2");
+  #endif
+}
+
+#endif
+
+//
+
+CompositeKernel nes::get_composite_kernel(CompositeLevel level) {
+    switch (level) {
+    case cl_SCALAR:
+        return composite_scalar;
+#ifdef NES_COMPOSITE_X86
+    case cl_SSE2:
+        return composite_sse2;
+    case cl_AVX2:
+        return cpu_has_avx2() ? composite_avx2 : nullptr;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+CompositeKernel nes::get_best_composite_kernel() {
+    if (auto kernel = get_composite_kernel(cl_AVX2)) {
+        return kernel;
+    }
+    if (auto kernel = get_composite_kernel(cl_SSE2)) {
+        return kernel;
+    }
+    return composite_scalar;
+}
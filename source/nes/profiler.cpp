@@ -0,0 +1,191 @@
+#include "nes/profiler.hpp"
+
+#include "common/log.hpp"
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <fstream>
+
+using namespace nes;
+
+//
+
+static constexpr u32 PRG_LOCATION = 0x80000000;
+
+//
+
+Profiler::Profiler(const Bus &b, const u8 *prg, u32 size)
+    : bus(&b), prgData(prg), prgSize(size), romSites(size), otherSites(0x10000) {
+    clear();
+}
+
+void Profiler::clear() {
+    opcodes = {};
+    std::fill(romSites.begin(), romSites.end(), Site{});
+    std::fill(otherSites.begin(), otherSites.end(), Site{});
+
+    nodes.assign(1, Node{0, 0});
+    nodeCycles.assign(1, 0);
+    children.clear();
+    node  = 0;
+    depth = 0;
+
+    expectedPC = 0;
+}
+
+void Profiler::resync(u16 pc) {
+    node       = 0;
+    depth      = 0;
+    expectedPC = pc;
+    push_frame(location(pc));
+}
+
+std::array<Profiler::Counter, am_ZPY + 1> Profiler::get_modes() const {
+    std::array<Counter, am_ZPY + 1> modes = {};
+    for (u32 opcode = 0; opcode < 256; opcode++) {
+        Counter &mode = modes[INSTRUCTION_LOOKUP[opcode].mode];
+        mode.executions += opcodes[opcode].executions;
+        mode.cycles += opcodes[opcode].cycles;
+    }
+    return modes;
+}
+
+//
+
+u32 Profiler::location(u16 pc) const {
+    const u8 *page = bus->get_read_page(pc >> 8);
+    if (in_prg(page)) {
+        u32 bank = (u32) (page - prgData) / BANK_SIZE;
+        return PRG_LOCATION | (bank << 16) | pc;
+    }
+    return pc;
+}
+
+void Profiler::push_frame(u32 location) {
+    depth++;
+    if (depth > MAX_DEPTH) {
+        return;
+    }
+
+    u64 key = ((u64) node << 32) | location;
+    auto it = children.find(key);
+    if (it != children.end()) {
+        node = it->second;
+        return;
+    }
+
+    u32 child = (u32) nodes.size();
+    nodes.push_back({node, location});
+    nodeCycles.push_back(0);
+    children.emplace(key, child);
+    node = child;
+}
+
+void Profiler::pop_frame() {
+    if (depth == 0) {
+        // returned from further up than the profiler has seen, e.g. an RTS jump table
+        return;
+    }
+    if (depth <= MAX_DEPTH) {
+        node = nodes[node].parent;
+    }
+    depth--;
+}
+
+std::string Profiler::format_location(u32 location) const {
+    if (location & PRG_LOCATION) {
+        return fmt::format("{:02X}:{:04X}", (location >> 16) & 0x7FFF, location & 0xFFFF);
+    }
+    return fmt::format("--:{:04X}", location);
+}
+
+//
+
+bool Profiler::write_csv(const std::string &filepath, ProfileTable table) const {
+    std::ofstream file(filepath);
+
+    switch (table) {
+    case prof_OPCODES:
+        file << "opcode,instruction,mode,executions,cycles\n";
+        for (u32 opcode = 0; opcode < 256; opcode++) {
+            const Counter &c = opcodes[opcode];
+            if (c.executions == 0) {
+                continue;
+            }
+            const Instruction &ins = INSTRUCTION_LOOKUP[opcode];
+            file << fmt::format("{:02X},{}{},{},{},{}\n", opcode,
+                                is_unofficial_opcode(opcode) ? "*" : "",
+                                INSTRUCTION_NAME_LOOKUP[ins.op], ADDRMODE_NAME_LOOKUP[ins.mode],
+                                c.executions, c.cycles);
+        }
+        break;
+    case prof_MODES: {
+        file << "mode,executions,cycles\n";
+        auto modes = get_modes();
+        for (u32 mode = 0; mode < modes.size(); mode++) {
+            file << fmt::format("{},{},{}\n", ADDRMODE_NAME_LOOKUP[mode], modes[mode].executions,
+                                modes[mode].cycles);
+        }
+        break;
+    }
+    case prof_PCS: {
+        // bank is the 8 KiB PRG bank the address was mapped to, -- for RAM and the like
+        file << "bank,address,opcode,instruction,executions,cycles\n";
+        auto write_site = [&](const std::string &bank, const Site &site) {
+            const Instruction &ins = INSTRUCTION_LOOKUP[site.opcode];
+            file << fmt::format("{},{:04X},{:02X},{}{} {},{},{}\n", bank, site.pc, site.opcode,
+                                is_unofficial_opcode(site.opcode) ? "*" : "",
+                                INSTRUCTION_NAME_LOOKUP[ins.op], ADDRMODE_NAME_LOOKUP[ins.mode],
+                                site.counter.executions, site.counter.cycles);
+        };
+        for (u32 offset = 0; offset < romSites.size(); offset++) {
+            if (romSites[offset].counter.executions != 0) {
+                write_site(fmt::format("{:02X}", offset / BANK_SIZE), romSites[offset]);
+            }
+        }
+        for (const Site &site : otherSites) {
+            if (site.counter.executions != 0) {
+                write_site("--", site);
+            }
+        }
+        break;
+    }
+    }
+
+    if (!file) {
+        log_message(log_ERROR, "Failed to write profile: {}", filepath);
+        return false;
+    }
+    return true;
+}
+
+bool Profiler::write_folded(const std::string &filepath) const {
+    std::ofstream file(filepath);
+
+    std::vector<u32> stack;
+    for (u32 n = 1; n < nodes.size(); n++) {
+        if (nodeCycles[n] == 0) {
+            continue;
+        }
+
+        stack.clear();
+        for (u32 at = n; at != 0; at = nodes[at].parent) {
+            stack.push_back(nodes[at].location);
+        }
+
+        std::string line = "nes";
+        for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+            line += ";" + format_location(*it);
+        }
+        file << line << " " << nodeCycles[n] << "\n";
+    }
+    if (nodeCycles[0] != 0) {
+        file << "nes " << nodeCycles[0] << "\n";
+    }
+
+    if (!file) {
+        log_message(log_ERROR, "Failed to write profile: {}", filepath);
+        return false;
+    }
+    return true;
+}
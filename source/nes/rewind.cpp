@@ -0,0 +1,251 @@
+#include "nes/rewind.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace nes;
+
+//
+
+/// smallest run of unchanged bytes worth ending a literal run for. shorter runs cost more in run
+/// headers than they save
+static constexpr size_t MIN_ZERO_RUN = 4;
+
+/// expected size of a delta frame, used to size the record table. if frames are smaller than this
+/// on average the table fills up before the ring does and the oldest frames are dropped early
+static constexpr size_t TYPICAL_FRAME_SIZE = 64;
+
+static inline u64 load_u64(const u8 *p) {
+    u64 value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline u8 *write_varint(u8 *out, size_t value) {
+    while (value >= 0x80) {
+        *out++ = (u8) (value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (u8) value;
+    return out;
+}
+
+static inline const u8 *read_varint(const u8 *in, size_t &value) {
+    value     = 0;
+    u32 shift = 0;
+    while (*in & 0x80) {
+        value |= (size_t) (*in++ & 0x7F) << shift;
+        shift += 7;
+    }
+    value |= (size_t) *in++ << shift;
+    return in;
+}
+
+//
+
+Rewind::Rewind(Core &c, size_t capacity, u32 interval)
+    : core(c), keyframeInterval(std::max(interval, 1u)), stateSize(c.get_save_state_size()) {
+    ring.resize(capacity);
+    records.resize(std::max<size_t>(capacity / TYPICAL_FRAME_SIZE, 1));
+
+    keyframeState.resize(stateSize);
+    decodedKeyframe.resize(stateSize);
+    zeros.resize(stateSize);
+    current.resize(stateSize);
+
+    // every run of the encoding covers at least MIN_ZERO_RUN + 1 bytes with two varint headers
+    encoded.resize(stateSize + stateSize / 2 + 32);
+}
+
+void Rewind::clear() {
+    head            = 0;
+    tail            = 0;
+    writeOffset     = 0;
+    usedBytes       = 0;
+    needKeyframe    = true;
+    decodedSequence = ~0ULL;
+}
+
+//
+
+void Rewind::push() {
+    if (!core.save_state(current.data(), stateSize)) {
+        return;
+    }
+
+    bool keyframe = needKeyframe || head - keyframeSequence >= keyframeInterval;
+    size_t size   = encode(current.data(), keyframe ? zeros.data() : keyframeState.data(),
+                           stateSize, encoded.data());
+    if (!reserve((u32) size)) {
+        needKeyframe = true;
+        return;
+    }
+
+    // making room may have dropped the keyframe this delta refers to
+    if (!keyframe && keyframeSequence < tail) {
+        keyframe = true;
+        size     = encode(current.data(), zeros.data(), stateSize, encoded.data());
+        if (!reserve((u32) size)) {
+            needKeyframe = true;
+            return;
+        }
+    }
+
+    record(head) = {writeOffset, (u32) size, keyframe ? head : keyframeSequence};
+    std::memcpy(&ring[writeOffset], encoded.data(), size);
+    writeOffset += (u32) size;
+    usedBytes += size;
+
+    if (keyframe) {
+        std::swap(keyframeState, current);
+        keyframeSequence = head;
+        needKeyframe     = false;
+        keyframes++;
+        keyframeBytes += size;
+    } else {
+        deltas++;
+        deltaBytes += size;
+    }
+
+    head++;
+}
+
+bool Rewind::pop() {
+    if (head == tail) {
+        return false;
+    }
+
+    u64 sequence     = head - 1;
+    const Record &r  = record(sequence);
+    const u8 *frame  = &ring[r.offset];
+    const u8 *result = nullptr;
+
+    if (r.keyframe == sequence) {
+        decode(frame, zeros.data(), stateSize, decodedKeyframe.data());
+        decodedSequence = sequence;
+        result          = decodedKeyframe.data();
+    } else {
+        if (decodedSequence != r.keyframe) {
+            decode(&ring[record(r.keyframe).offset], zeros.data(), stateSize,
+                   decodedKeyframe.data());
+            decodedSequence = r.keyframe;
+        }
+        decode(frame, decodedKeyframe.data(), stateSize, current.data());
+        result = current.data();
+    }
+
+    bool ok = core.load_state(result, stateSize);
+
+    head        = sequence;
+    writeOffset = r.offset;
+    usedBytes -= r.size;
+
+    // sequence numbers from head on get reused by the next push
+    if (keyframeSequence >= head) {
+        needKeyframe = true;
+    }
+    if (decodedSequence >= head) {
+        decodedSequence = ~0ULL;
+    }
+
+    return ok;
+}
+
+//
+
+void Rewind::evict() {
+    usedBytes -= record(tail).size;
+    tail++;
+}
+
+bool Rewind::reserve(u32 size) {
+    if (size > ring.size()) {
+        return false;
+    }
+
+    if (head - tail == records.size()) {
+        evict();
+    }
+
+    // frames are stored contiguously, if the end of the ring is too short everything stored
+    // there is older than what's at the start, so drop it and wrap around
+    if (writeOffset + size > ring.size()) {
+        while (head != tail && record(tail).offset >= writeOffset) {
+            evict();
+        }
+        writeOffset = 0;
+    }
+
+    // the oldest frames sit right after the write offset
+    while (head != tail && record(tail).offset >= writeOffset &&
+           record(tail).offset < writeOffset + size) {
+        evict();
+    }
+
+    // deltas are useless without their keyframe
+    while (head != tail && record(tail).keyframe != tail) {
+        evict();
+    }
+
+    return true;
+}
+
+//
+
+size_t Rewind::encode(const u8 *state, const u8 *key, size_t size, u8 *out) {
+    u8 *start = out;
+    size_t i  = 0;
+
+    // alternating runs of unchanged bytes (skipped) and changed bytes (stored XORed with the key)
+    while (i < size) {
+        size_t zeroStart = i;
+        while (i + 8 <= size && load_u64(state + i) == load_u64(key + i)) {
+            i += 8;
+        }
+        while (i < size && state[i] == key[i]) {
+            i++;
+        }
+
+        size_t literalStart = i;
+        while (i < size) {
+            if (state[i] != key[i]) {
+                i++;
+                continue;
+            }
+
+            size_t j = i;
+            while (j < size && j - i < MIN_ZERO_RUN && state[j] == key[j]) {
+                j++;
+            }
+            if (j - i >= MIN_ZERO_RUN || j == size) {
+                break;
+            }
+            i = j;
+        }
+
+        out = write_varint(out, literalStart - zeroStart);
+        out = write_varint(out, i - literalStart);
+        for (size_t k = literalStart; k < i; k++) {
+            *out++ = state[k] ^ key[k];
+        }
+    }
+
+    return out - start;
+}
+
+void Rewind::decode(const u8 *in, const u8 *key, size_t size, u8 *out) {
+    std::memcpy(out, key, size);
+
+    size_t i = 0;
+    while (i < size) {
+        size_t zeros, literals;
+        in = read_varint(in, zeros);
+        in = read_varint(in, literals);
+        i += zeros;
+        for (size_t k = 0; k < literals; k++) {
+            out[i + k] ^= in[k];
+        }
+        i += literals;
+        in += literals;
+    }
+}
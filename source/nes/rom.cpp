@@ -1,145 +1,213 @@
 #include "nes/rom.hpp"
+#include "nes/rom_database.hpp"
 
-#include <fstream>
-#include <raylib.h>
-#include <fmt/core.h>
+#include "common/crc32.hpp"
+#include "common/log.hpp"
+
+#include <algorithm>
+#include <cstring>
 
 using namespace nes;
 
 //
 
+static constexpr u32 HEADER_SIZE = 16;
+
 static constexpr u32 CHR_ROM_PAGE_SIZE =  8 * 1024;
 static constexpr u32 PRG_ROM_PAGE_SIZE = 16 * 1024;
 
-static constexpr u16 PRG_BASE_ADDRESS = 0x8000;
+/// $6000-$7FFF, none of the supported mappers bank PRG RAM
+static constexpr u32 PRG_RAM_MAX_SIZE = 8 * 1024;
+static constexpr u32 PRG_RAM_MIN_SIZE = 256;
 
 //
 
-Rom::Rom(const char *romFile) {
-    std::ifstream rom(romFile, std::ios::binary);
-
-    if (rom.good()) {
-        u8 header[16];
-        rom.read((char *) header, sizeof(header));
-
-        // check file format
-        if (header[0] == 0x4E && // 'N'
-            header[1] == 0x45 && // 'E'
-            header[2] == 0x53 && // 'S'
-            header[3] == 0x1A    // EOF
-        ) {
-            if (header[7] & 0x0C) {
-                TraceLog(LOG_ERROR, "NES 2.0 Rom not supported");
-                return;
-            }
-        } else {
-            TraceLog(LOG_ERROR, "Unrecognized Rom file format");
-            return;
-        }
-
-        u32 prgRomSize = header[4] * PRG_ROM_PAGE_SIZE;
-        u32 chrRomSize = header[5] * CHR_ROM_PAGE_SIZE;
+/// grow data[offset, offset + size) to the next power of two. the part past the largest power of
+/// two is mirrored on its own, the way a board with two differently sized chips decodes it. this
+/// keeps the last bank last
+static void mirror_to_power_of_two(std::vector<u8> &data, u32 offset, u32 size) {
+    u32 high = 1;
+    while (high * 2 <= size) {
+        high *= 2;
+    }
+    if (high == size) {
+        return;
+    }
 
-        bool fourScreen = (header[6] & 0x08) != 0;
-        bool vertMirror = (header[6] & 0x01) == 1;
+    u32 target = high * 2;
+    if (data.size() < offset + target) {
+        data.resize(offset + target);
+    }
 
-        mirror = fourScreen ? sm_FOUR_SCREEN : (vertMirror ? sm_VERTICAL : sm_HORIZONTAL);
+    u32 tail = offset + high;
+    mirror_to_power_of_two(data, tail, size - high);
 
-        // check for trainer data, ignoring it for now
-        if (header[6] & 0x04) {
-            rom.seekg(512, std::ios::cur);
-        }
+    // the tail is a power of two now, repeat it over the rest of the upper half
+    u32 tailSize = 1;
+    while (tailSize < size - high) {
+        tailSize *= 2;
+    }
+    for (u32 o = tailSize; o < high; o += tailSize) {
+        std::copy_n(&data[tail], tailSize, &data[tail + o]);
+    }
+}
 
-        // get mapper id and set mapper. TODO: implement mapper and set mapper here
-        u8 mapperId = (header[7] & 0xF0) | (header[6] >> 4);
-        if (mapperId != 0) {
-            // currently only NROM mapper (mapper-0) is supported.
-            TraceLog(LOG_ERROR, fmt::format("Unsupported mapper. MapperID: {}", mapperId).c_str());
-        }
+/// the image itself if it can be used as is, otherwise a padded copy in the given buffer
+static const u8 *pad_image(const u8 *data, u32 &size, u32 minimum, std::vector<u8> &copy) {
+    if (size >= minimum && (size & (size - 1)) == 0) {
+        return data;
+    }
 
-        // read rom data
+    copy.assign(data, data + size);
+    mirror_to_power_of_two(copy, 0, size);
+    while (copy.size() < minimum) {
+        copy.insert(copy.end(), copy.begin(), copy.end());
+    }
 
-        prgMem.resize(prgRomSize);
-        rom.read((char *) (&prgMem[0]), prgRomSize);
+    size = (u32) copy.size();
+    return copy.data();
+}
 
-        chrMem.resize(chrRomSize);
-        rom.read((char *) (&chrMem[0]), chrRomSize);
+/// NES 2.0 ROM size, either a count of units or an exponent / multiplier pair if the high nibble
+/// is all ones. returns 0 for sizes that don't fit in 32 bits
+static u32 nes2_rom_size(u8 lsb, u8 msb, u32 unit) {
+    if (msb == 0x0F) {
+        u32 exponent = lsb >> 2;
+        return exponent < 28 ? (1u << exponent) * ((lsb & 0x03) * 2 + 1) : 0;
+    }
+    return ((msb << 8) | lsb) * unit;
+}
 
-        rom.close();
-        romStatusOk = true;
-    } else {
-        TraceLog(LOG_ERROR, fmt::format("Failed to open rom file: {}", romFile).c_str());
+/// PRG RAM size rounded up to a power of two that can be mapped page by page into $6000-$7FFF
+static u32 fit_prg_ram(u32 size) {
+    if (size == 0) {
+        return 0;
+    }
+    u32 fitted = PRG_RAM_MIN_SIZE;
+    while (fitted < size && fitted < PRG_RAM_MAX_SIZE) {
+        fitted *= 2;
     }
+    return fitted;
 }
 
 //
 
-u8 Rom::read_prg_u8(u16 address) {
-    if (address < PRG_BASE_ADDRESS) {
-        // NOTE: check for battery backed ram, if I decide to add it, but currently not valid
-        TraceLog(LOG_WARNING, fmt::format("PRG_ROM attempt to read address below PRG base address."
-                                          "Read attempt at: 0x{:04x}",
-                                          address)
-                                  .c_str());
-    } else {
-        // ideally we get this from a mapper, but currently we only use mapper-0
-        u16 mappedAddr = address - PRG_BASE_ADDRESS;
-        if (mappedAddr >= prgMem.size()) {
-            TraceLog(LOG_ERROR, "PRG_ROM attempt to read address beyond PRG length.");
-        } else {
-            return prgMem[mappedAddr];
-        }
+Rom::Rom(const char *romFile, const RomDatabase *database) {
+    if (!file.open(romFile)) {
+        log_message(log_ERROR, "Failed to open rom file: {}", romFile);
+        return;
     }
 
-    return 0;
-}
+    const u8 *header = file.data();
+
+    // check file format
+    if (file.size() < HEADER_SIZE || std::memcmp(header, "NES\x1A", 4) != 0) {
+        log_message(log_ERROR, "Unrecognized Rom file format");
+        return;
+    }
+
+    bool nes2 = (header[7] & 0x0C) == 0x08;
 
-u8 Rom::read_chr_u8(u16 address) {
-    if (address > 0x1FFF) {
-        TraceLog(LOG_ERROR, fmt::format("CHR_ROM attempt to read beyond CHR Max Address."
-                                        "Read attempt at: 0x{:04x}",
-                                        address)
-                                .c_str());
+    u32 prgRomSize, chrRomSize, chrRamSize = CHR_ROM_PAGE_SIZE;
+    bool prgRamKnown = nes2;
+    if (nes2) {
+        prgRomSize = nes2_rom_size(header[4], header[9] & 0x0F, PRG_ROM_PAGE_SIZE);
+        chrRomSize = nes2_rom_size(header[5], header[9] >> 4, CHR_ROM_PAGE_SIZE);
+        mapperId   = ((header[8] & 0x0F) << 8) | (header[7] & 0xF0) | (header[6] >> 4);
+        if (header[11] & 0x0F) {
+            chrRamSize = std::max<u32>(chrRamSize, 64 << (header[11] & 0x0F));
+        }
+        // volatile and battery backed sizes, both shift counts with 0 meaning none
+        for (u32 shift : {header[10] & 0x0F, header[10] >> 4}) {
+            prgRamSize += shift != 0 ? 64 << shift : 0;
+        }
     } else {
-        if (address >= chrMem.size()) {
-            TraceLog(LOG_ERROR, "CHR_ROM attempt to read address beyond CHR length.");
-        } else {
-            return chrMem[address];
+        prgRomSize = header[4] * PRG_ROM_PAGE_SIZE;
+        chrRomSize = header[5] * CHR_ROM_PAGE_SIZE;
+        mapperId   = (header[7] & 0xF0) | (header[6] >> 4);
+
+        // iNES 1.0 only has a size when it isn't 0, and a battery bit
+        if (header[8] != 0) {
+            prgRamSize  = header[8] * PRG_RAM_MAX_SIZE;
+            prgRamKnown = true;
+        } else if (header[6] & 0x02) {
+            prgRamSize  = PRG_RAM_MAX_SIZE;
+            prgRamKnown = true;
+        }
+
+        // old dumping tools wrote a signature ("DiskDude!") over bytes 7-15, which would end up
+        // in the upper mapper nibble
+        if (header[12] != 0 || header[13] != 0 || header[14] != 0 || header[15] != 0) {
+            log_message(log_WARNING, "Garbage in iNES header, ignoring the upper mapper bits");
+            mapperId &= 0x0F;
         }
     }
 
-    return 0;
-}
+    if (prgRomSize == 0) {
+        log_message(log_ERROR, "Rom has no PRG ROM");
+        return;
+    }
 
-void Rom::write_prg_u8(u16 address, u8 data) {
-    if (address < PRG_BASE_ADDRESS) {
-        // NOTE: fix this if battery backed RAM added
-        TraceLog(LOG_WARNING,
-                 fmt::format("PRG_ROM attempt to write to address below PRG base address."
-                             "Write attempt at: 0x{:04x}",
-                             address)
-                     .c_str());
-    } else {
-        u16 mappedAddr = address - PRG_BASE_ADDRESS;
-        if (mappedAddr >= prgMem.size()) {
-            TraceLog(LOG_ERROR, "PRG_ROM attempt to write to address beyond PRG length.");
-        } else {
-            prgMem[mappedAddr] = data;
+    bool fourScreen = (header[6] & 0x08) != 0;
+    bool vertMirror = (header[6] & 0x01) == 1;
+
+    mirror = fourScreen ? sm_FOUR_SCREEN : (vertMirror ? sm_VERTICAL : sm_HORIZONTAL);
+
+    // rom data, PRG and CHR are views into the file
+
+    u64 offset = HEADER_SIZE;
+    if (header[6] & 0x04) {
+        trainer = file.data() + offset;
+        offset += TRAINER_SIZE;
+    }
+
+    if (file.size() < offset + prgRomSize + chrRomSize) {
+        log_message(log_ERROR, "Rom file is truncated: {}", romFile);
+        return;
+    }
+
+    prgData = file.data() + offset;
+    prgSize = prgRomSize;
+    chrData = file.data() + offset + prgRomSize;
+    chrSize = chrRomSize;
+
+    crc = crc32(prgData, prgSize + chrSize);
+
+    if (const RomDatabase::Entry *entry = database ? database->find(crc) : nullptr) {
+        log_message(log_INFO, "Applying rom database entry for CRC32 {:08X}", crc);
+        mapperId = entry->mapperId;
+        if (entry->mirroring != sm_UNDEFINED) {
+            mirror = entry->mirroring;
+        }
+        if (entry->prgRamSize != RomDatabase::KEEP_PRG_RAM) {
+            prgRamSize  = entry->prgRamSize;
+            prgRamKnown = true;
         }
     }
-}
 
-void Rom::write_chr_u8(u16 address, u8 data) {
-    if (address > 0x1FFF) {
-        TraceLog(LOG_ERROR, fmt::format("CHR_ROM attempt to read beyond CHR Max Address."
-                                        "Read attempt at: 0x{:04x}",
-                                        address)
-                                .c_str());
+    // otherwise iNES 1.0 can't tell. MMC1 and MMC3 boards nearly all carry 8 KiB whether it is
+    // battery backed or not, the discrete logic boards of the other mappers don't
+    if (!prgRamKnown && (mapperId == 1 || mapperId == 4)) {
+        prgRamSize = PRG_RAM_MAX_SIZE;
+    }
+
+    // the trainer is loaded to $7000
+    if (trainer != nullptr) {
+        prgRamSize = PRG_RAM_MAX_SIZE;
+    }
+    prgRamSize = fit_prg_ram(prgRamSize);
+
+    // everything past this point can assume power of two sizes, i.e. a bank number just needs
+    // masking
+    prgData = pad_image(prgData, prgSize, PRG_ROM_PAGE_SIZE, prgCopy);
+
+    if (chrSize != 0) {
+        chrData = pad_image(chrData, chrSize, CHR_ROM_PAGE_SIZE, chrCopy);
     } else {
-        if (address >= chrMem.size()) {
-            TraceLog(LOG_ERROR, "CHR_ROM attempt to read address beyond CHR length.");
-        } else {
-            chrMem[address] = data;
-        }
+        // always a power of two, the mapper allocates it
+        chrData = nullptr;
+        chrSize = chrRamSize;
     }
+
+    romStatusOk = true;
 }
@@ -0,0 +1,82 @@
+#include "nes/rom_database.hpp"
+
+#include "common/log.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace nes;
+
+//
+
+bool RomDatabase::load(const char *file) {
+    std::ifstream stream(file);
+    if (!stream.good()) {
+        log_message(log_ERROR, "Failed to open rom database: {}", file);
+        return false;
+    }
+
+    std::string line;
+    for (u32 number = 1; std::getline(stream, line); number++) {
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream fields(line);
+        std::string crc, mirroring, prgRam;
+        u32 mapperId;
+        if (!(fields >> crc)) {
+            continue; // empty or comment
+        }
+
+        Entry entry;
+        if (!(fields >> mapperId >> mirroring) || crc.size() != 8 || mapperId > 0xFFF ||
+            crc.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+            log_message(log_ERROR, "Bad rom database entry, {} line {}", file, number);
+            return false;
+        }
+
+        entry.crc32    = (u32) std::stoul(crc, nullptr, 16);
+        entry.mapperId = (u16) mapperId;
+
+        if (mirroring == "H") {
+            entry.mirroring = Rom::sm_HORIZONTAL;
+        } else if (mirroring == "V") {
+            entry.mirroring = Rom::sm_VERTICAL;
+        } else if (mirroring == "4") {
+            entry.mirroring = Rom::sm_FOUR_SCREEN;
+        } else if (mirroring == "-") {
+            entry.mirroring = Rom::sm_UNDEFINED;
+        } else {
+            log_message(log_ERROR, "Bad rom database mirroring, {} line {}", file, number);
+            return false;
+        }
+
+        entry.prgRamSize = KEEP_PRG_RAM;
+        if (fields >> prgRam && prgRam != "-") {
+            if (prgRam.find_first_not_of("0123456789") != std::string::npos ||
+                prgRam.size() > 2 || std::stoul(prgRam) > 8) {
+                log_message(log_ERROR, "Bad rom database PRG RAM size, {} line {}", file, number);
+                return false;
+            }
+            entry.prgRamSize = (u32) std::stoul(prgRam) * 1024;
+        }
+
+        entries.push_back(entry);
+    }
+
+    // later entries win
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry &a, const Entry &b) { return a.crc32 < b.crc32; });
+
+    return true;
+}
+
+const RomDatabase::Entry *RomDatabase::find(u32 crc32) const {
+    auto it = std::upper_bound(entries.begin(), entries.end(), crc32,
+                               [](u32 crc, const Entry &e) { return crc < e.crc32; });
+    if (it == entries.begin() || (it - 1)->crc32 != crc32) {
+        return nullptr;
+    }
+    return &*(it - 1);
+}
@@ -0,0 +1,87 @@
+#include "nes/run_ahead.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace nes;
+
+//
+
+/// weight of a new measurement in the moving averages
+static constexpr double COST_SMOOTHING = 0.05;
+
+/// share of the frame budget run-ahead may use, the rest is left for presenting and jitter
+static constexpr double BUDGET_SHARE = 0.75;
+
+using Clock = std::chrono::steady_clock;
+
+static inline double seconds_between(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static inline void update_average(double &average, double sample) {
+    average = average == 0.0 ? sample : average + (sample - average) * COST_SMOOTHING;
+}
+
+//
+
+RunAhead::RunAhead(Core &c) : core(c) {
+    state.resize(core.get_save_state_size());
+}
+
+void RunAhead::run_frame() {
+    auto start = Clock::now();
+    core.run_frame();
+    auto real = Clock::now();
+
+    update_average(realFrameCost, seconds_between(start, real));
+    lastCost = seconds_between(start, real);
+
+    if (frames == 0) {
+        return;
+    }
+
+    // the state size only changes with the rom, so this only allocates after a rom change
+    size_t stateSize = core.get_save_state_size();
+    if (state.size() != stateSize) {
+        state.resize(stateSize);
+    }
+    if (!core.save_state(state.data(), stateSize)) {
+        return;
+    }
+
+    // only the real timeline is heard, profiled and traced, the speculative frames are rolled
+    // back below
+    Profiler *profiler = core.cpu.profiler;
+    TraceRing *trace   = core.cpu.trace;
+    core.cpu.profiler  = nullptr;
+    core.cpu.trace     = nullptr;
+    core.apu.set_muted(true);
+    for (u32 i = 0; i < frames; i++) {
+        core.run_frame();
+    }
+
+    // the restore leaves the ppu output alone, so the speculative frame stays up for presenting.
+    // it puts the cpu back where the profiler last saw it, so the profiler can go on as if the
+    // speculative frames never ran
+    core.load_state(state.data(), stateSize);
+    core.apu.set_muted(false);
+    core.cpu.profiler = profiler;
+    core.cpu.trace    = trace;
+    auto end = Clock::now();
+
+    update_average(aheadFrameCost, seconds_between(real, end) / frames);
+    lastCost = seconds_between(start, end);
+}
+
+void RunAhead::tune(double budgetSeconds, u32 maxFrames) {
+    double available = budgetSeconds * BUDGET_SHARE - realFrameCost;
+
+    double affordable = 0.0;
+    if (available > 0.0) {
+        // nothing measured yet, start from one frame and let the measurements settle
+        affordable = aheadFrameCost > 0.0 ? available / aheadFrameCost : 1.0;
+    }
+
+    set_frames((u32) std::min(affordable, (double) maxFrames));
+}
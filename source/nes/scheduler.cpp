@@ -0,0 +1,90 @@
+#include "nes/scheduler.hpp"
+
+#include <algorithm>
+
+using namespace nes;
+
+//
+
+void Scheduler::attach(Cpu *c, BlockCache *b) {
+    cpu        = c;
+    blockCache = b;
+}
+
+void Scheduler::set_handler(EventType event, EventCallback callback, void *context) {
+    events[event].callback = callback;
+    events[event].context  = context;
+}
+
+void Scheduler::schedule(EventType event, u64 time) {
+    events[event].deadline = time;
+    nextDeadline           = std::min(nextDeadline, time);
+
+    if (time < batchEnd) {
+        blockCache->yield();
+    }
+}
+
+void Scheduler::cancel(EventType event) {
+    events[event].deadline = NEVER;
+    update_next_deadline();
+}
+
+void Scheduler::save_state(State &state) const {
+    for (u32 i = 0; i < ev_COUNT; i++) {
+        state.deadlines[i] = events[i].deadline;
+    }
+}
+
+void Scheduler::load_state(const State &state) {
+    for (u32 i = 0; i < ev_COUNT; i++) {
+        events[i].deadline = state.deadlines[i];
+    }
+    update_next_deadline();
+}
+
+//
+
+void Scheduler::run_until(u64 target) {
+    dispatch_due_events();
+
+    while (now() < target) {
+        u64 stop = std::min(target, nextDeadline);
+
+        // round up, the cpu can only stop on whole cycles
+        u64 cycles = (stop - now() + MASTER_CYCLES_PER_CPU_CYCLE - 1) /
+                     MASTER_CYCLES_PER_CPU_CYCLE;
+
+        batchEnd = stop;
+        blockCache->run(cycles);
+        batchEnd = 0;
+
+        dispatch_due_events();
+    }
+}
+
+//
+
+void Scheduler::dispatch_due_events() {
+    while (nextDeadline <= now()) {
+        u64 timestamp = now();
+        for (auto &e : events) {
+            if (e.deadline <= timestamp) {
+                u64 due    = e.deadline;
+                e.deadline = NEVER;
+                if (e.callback != nullptr) {
+                    e.callback(e.context, due);
+                }
+            }
+        }
+        // callbacks may have scheduled new events, possibly already due
+        update_next_deadline();
+    }
+}
+
+void Scheduler::update_next_deadline() {
+    nextDeadline = NEVER;
+    for (const auto &e : events) {
+        nextDeadline = std::min(nextDeadline, e.deadline);
+    }
+}
@@ -1,5 +1,9 @@
 #include "nes/system.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <utility>
 #include <raylib.h>
 
 using namespace nes;
@@ -13,90 +17,384 @@ using namespace nes;
 static Font FONT_16PX;
 static Font FONT_20PX;
 
+// ppu output, uploaded to the texture whenever a new frame arrives
+static Texture2D SCREEN_TEXTURE;
+
+// raylib's audio callback takes no context, so it finds the ring through here
+static AudioStream AUDIO_STREAM;
+static AudioRing *AUDIO_RING = nullptr;
+
+static const char *QUICKSAVE_FILE = "quicksave.state";
+static const char *TRACE_FILE     = "trace.bin";
+
 static const Color COLOR_BG    = {0xF9, 0xFB, 0xE7, 0xFF}; // color code: #f9fbe7
 static const Color COLOR_FG    = {0x20, 0x20, 0x20, 0xFF}; // color code: #202020
 static const Color COLOR_INFO  = {0x24, 0xA1, 0x9C, 0xFF}; // color code: #24a19c
 static const Color COLOR_ERROR = {0xFB, 0x25, 0x76, 0xFF}; // color code: #fb2576
 
+using Clock = std::chrono::steady_clock;
+
+/// NTSC frame period, ~60.1 Hz
+static constexpr double FRAME_SECONDS =
+    (double) Scheduler::MASTER_CYCLES_PER_FRAME /
+    (CPU_CLOCK_RATE_HZ * Scheduler::MASTER_CYCLES_PER_CPU_CYCLE);
+
+static constexpr auto FRAME_PERIOD =
+    std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(FRAME_SECONDS));
+
+/// how often the emulation thread looks for commands while paused
+static constexpr auto IDLE_POLL = std::chrono::milliseconds(1);
+
+/// fast forward runs far more frames than can be shown, only publish some of them
+static constexpr auto FAST_FORWARD_PUBLISH_PERIOD = std::chrono::milliseconds(4);
+
+static constexpr u32 AUDIO_SAMPLE_RATE = 48000;
+
+/// ~85 ms, kept half full. the device callback asks for AUDIO_DEVICE_FRAMES at a time
+static constexpr size_t AUDIO_RING_SAMPLES = 4096;
+static constexpr u32 AUDIO_DEVICE_FRAMES   = 512;
+
+/// most the output rate is moved off nominal to follow the device clock, 0.5%. the frame pacing
+/// and the device drift apart by far less than that, and a change this small is not heard
+static constexpr double MAX_RATE_DEVIATION = 0.005;
+
+static void audio_callback(void *buffer, unsigned int frames) {
+    AUDIO_RING->read(static_cast<int16_t *>(buffer), frames);
+}
+
 //
 
-System::System() : bus(), cpu(), mem() {
+System::System()
+    : core(), runAhead(core), frames(std::make_unique<TripleBuffer<VideoFrame>>()),
+      audio(AUDIO_RING_SAMPLES) {
     SetConfigFlags(FLAG_VSYNC_HINT | FLAG_MSAA_4X_HINT);
     InitWindow(900, 900, "NES emulator test");
 
-    bus.attach_components(&cpu, &mem);
-
     FONT_16PX = LoadFontEx("assets/fonts/firacode-nf.ttf", 16, nullptr, 256);
     FONT_20PX = LoadFontEx("assets/fonts/firacode-nf.ttf", 20, nullptr, 256);
+
+    Image screen = {(void *) frames->read_buffer().pixels.data(), Ppu::SCREEN_WIDTH,
+                    Ppu::SCREEN_HEIGHT, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+    SCREEN_TEXTURE = LoadTextureFromImage(screen);
+
+    InitAudioDevice();
+    SetAudioStreamBufferSizeDefault(AUDIO_DEVICE_FRAMES);
+    AUDIO_STREAM = LoadAudioStream(AUDIO_SAMPLE_RATE, 16, 1);
+    AUDIO_RING   = &audio;
+    SetAudioStreamCallback(AUDIO_STREAM, audio_callback);
+    PlayAudioStream(AUDIO_STREAM);
+
+    core.apu.set_sample_rate(AUDIO_SAMPLE_RATE);
+    audioSamples.resize(AUDIO_RING_SAMPLES);
+
+    if (romDatabase.load("assets/romdb.txt")) {
+        core.romDatabase = &romDatabase;
+    }
+
+    // always on, the last instructions are what is needed to find out why a session hung
+    core.cpu.trace = &trace;
+    trace.dump_on_crash(TRACE_FILE);
 }
 
 System::~System() {
-    delete rom;
+    quit = true;
+    if (emulationThread.joinable()) {
+        emulationThread.join();
+    }
+
+    UnloadAudioStream(AUDIO_STREAM);
+    CloseAudioDevice();
+    AUDIO_RING = nullptr;
+
+    UnloadTexture(SCREEN_TEXTURE);
     CloseWindow();
 }
 
 //
 
 void System::load_rom(const std::string &filepath) {
-    // NOTE: ensure no previous Rom exists, if I add Rom loading allowed during runtime
-    rom = new Rom(filepath.c_str());
-
-    mem.write_u8(0x00, 0xFFFC);
-    mem.write_u8(0x80, 0xFFFD);
-
-    cpu.reset();
+    if (!core.load_rom(filepath)) {
+        TraceLog(LOG_ERROR, "Failed to load rom, running without a cartridge");
+        core.reset();
+    }
 }
 
 void System::run() {
+    emulationThread = std::thread(&System::emulation_loop, this);
+
     while (!WindowShouldClose()) {
-        draw();
+        update_input();
         handle_events();
+        draw();
+    }
+
+    quit = true;
+    emulationThread.join();
+}
+
+//
+
+void System::emulation_loop() {
+    auto nextFrame   = Clock::now();
+    auto lastPublish = Clock::now();
+
+    publish_frame(0.0);
+
+    while (!quit.load(std::memory_order_relaxed)) {
+        bool changed = false;
+
+        Command command;
+        while (commands.pop(command)) {
+            changed |= execute(command);
+        }
+
+        if (!running && !fastForward) {
+            if (changed) {
+                queue_audio();
+                publish_frame(0.0);
+            }
+            std::this_thread::sleep_for(IDLE_POLL);
+            nextFrame = Clock::now();
+            continue;
+        }
+
+        // fast forward makes sound far quicker than it can be played, it stays quiet instead
+        core.apu.set_muted(fastForward);
+
+        auto start = Clock::now();
+        if (fastForward) {
+            // run-ahead only hides latency, it's wasted work when nobody can keep up anyway
+            core.run_frame();
+        } else {
+            if (autoRunAhead) {
+                runAhead.tune(FRAME_SECONDS, runAheadLimit);
+            }
+            runAhead.run_frame();
+        }
+        auto end = Clock::now();
+
+        queue_audio();
+
+        if (!fastForward || end - lastPublish >= FAST_FORWARD_PUBLISH_PERIOD) {
+            publish_frame(std::chrono::duration<double>(end - start).count());
+            lastPublish = end;
+        }
+
+        if (!fastForward) {
+            // after a stall (or coming out of fast forward) start pacing from now instead of
+            // running frames back to back to catch up
+            nextFrame += FRAME_PERIOD;
+            if (nextFrame < end) {
+                nextFrame = end;
+            }
+            std::this_thread::sleep_until(nextFrame);
+        }
+    }
+}
+
+bool System::execute(const Command &command) {
+    switch (command.type) {
+    case cmd_BUTTONS:
+        core.controllers.set_buttons(0, (u8) command.value);
+        return false;
+    case cmd_STEP:
+        core.step();
+        return true;
+    case cmd_FRAME:
+        core.run_frame();
+        return true;
+    case cmd_RESET:
+        core.cpu.reset();
+        return true;
+    case cmd_IRQ:
+        core.cpu.irq();
+        return true;
+    case cmd_NMI:
+        core.cpu.nmi();
+        return true;
+    case cmd_SAVE_STATE:
+        core.save_state_file(QUICKSAVE_FILE);
+        return false;
+    case cmd_LOAD_STATE:
+        core.load_state_file(QUICKSAVE_FILE);
+        return true;
+    case cmd_PLAY:
+        running = !running;
+        return true;
+    case cmd_FAST_FORWARD:
+        fastForward = !fastForward;
+        return true;
+    case cmd_RUN_AHEAD_MORE:
+        runAheadLimit = std::min(runAheadLimit + 1, RunAhead::MAX_FRAMES);
+        runAhead.set_frames(runAheadLimit);
+        return true;
+    case cmd_RUN_AHEAD_LESS:
+        runAheadLimit = runAheadLimit > 0 ? runAheadLimit - 1 : 0;
+        runAhead.set_frames(runAheadLimit);
+        return true;
+    case cmd_AUTO_RUN_AHEAD:
+        autoRunAhead = !autoRunAhead;
+        runAhead.set_frames(runAheadLimit);
+        return true;
+    }
+    return false;
+}
+
+void System::publish_frame(double frameCost) {
+    VideoFrame &frame = frames->write_buffer();
+
+    core.ppu.frame_to_rgba(frame.pixels.data());
+    frame.cpu            = core.cpu;
+    frame.frameCount     = core.ppu.frameCount;
+    frame.runAheadFrames = runAhead.get_frames();
+    frame.running        = running;
+    frame.fastForward    = fastForward;
+    frame.autoRunAhead   = autoRunAhead;
+    frame.frameCost      = frameCost;
+
+    frames->publish();
+}
+
+void System::queue_audio() {
+    while (size_t n = core.apu.read_samples(audioSamples.data(), audioSamples.size())) {
+        audio.write(audioSamples.data(), n);
     }
+
+    // dynamic rate control: a little faster below half full, a little slower above, so the
+    // ring settles where the device clock and the frame pacing agree
+    double fill = audio.fill();
+    core.apu.set_rate_ratio(1.0 + MAX_RATE_DEVIATION * (1.0 - 2.0 * fill));
 }
 
 //
 
 void System::draw() {
+    if (frames->update()) {
+        UpdateTexture(SCREEN_TEXTURE, frames->read_buffer().pixels.data());
+    }
+    const VideoFrame &frame = frames->read_buffer();
+
     BeginDrawing();
 
     ClearBackground(COLOR_BG);
 
-    DrawText("SPACE = Advance    R = RESET    I = IRQ    N = NMI", 10, 850, 16, COLOR_FG);
+    DrawText("SPACE = Advance    F = Frame    R = RESET    I = IRQ    N = NMI    H = Overlay", 10,
+             850, 16, COLOR_FG);
+    DrawText("P = Play    TAB = Fast    [ ] = Run-ahead    T = Auto    Arrows Z X RSHIFT ENTER",
+             10, 870, 16, COLOR_FG);
 
-    // print registers
-    DrawText("Registers", 10, 12, 16, COLOR_FG);
-    DrawRectangleLinesEx({5, 33, 150, 175}, 5, COLOR_FG);
-    auto pos = Vector2{20, 50};
-    for (const auto &r : cpu.registers_to_strings()) {
-        DrawTextEx(FONT_16PX, r.c_str(), pos, 16, 1.2, COLOR_FG);
-        pos.y += 25;
-    }
+    // ppu output, scaled 2x
+    DrawTextureEx(SCREEN_TEXTURE, {370, 12}, 0, 2, WHITE);
+
+    if (showOverlay) {
+        overlay.update(frame.cpu, {frame.running, frame.fastForward, frame.autoRunAhead,
+                                   frame.runAheadFrames, frame.frameCost, audio.fill(),
+                                   audio.get_underruns(), audio.get_overruns()});
+
+        // print registers
+        DrawText("Registers", 10, 12, 16, COLOR_FG);
+        DrawRectangleLinesEx({5, 33, 150, 175}, 5, COLOR_FG);
+        auto pos = Vector2{20, 50};
+        for (const auto &r : overlay.get_registers()) {
+            DrawTextEx(FONT_16PX, r.c_str(), pos, 16, 1.2, COLOR_FG);
+            pos.y += 25;
+        }
 
-    // print instruction
-    DrawTextEx(FONT_16PX, cpu.get_executing_instruction().c_str(), {10, 300}, 16, 1.2, COLOR_INFO);
+        // print instruction
+        DrawTextEx(FONT_16PX, overlay.get_instruction().c_str(), {10, 300}, 16, 1.2, COLOR_INFO);
+
+        // emulation status, cost is the real frame plus the frames run ahead
+        DrawTextEx(FONT_16PX, overlay.get_status().c_str(), {10, 330}, 16, 1.2,
+                   frame.running ? COLOR_INFO : COLOR_FG);
+        DrawTextEx(FONT_16PX, overlay.get_audio().c_str(), {10, 355}, 16, 1.2, COLOR_FG);
+    }
 
     EndDrawing();
 }
 
+void System::update_input() {
+    static constexpr std::array<std::pair<int, Button>, 8> KEY_MAP = {{
+        {KEY_X, btn_A},
+        {KEY_Z, btn_B},
+        {KEY_RIGHT_SHIFT, btn_SELECT},
+        {KEY_ENTER, btn_START},
+        {KEY_UP, btn_UP},
+        {KEY_DOWN, btn_DOWN},
+        {KEY_LEFT, btn_LEFT},
+        {KEY_RIGHT, btn_RIGHT},
+    }};
+
+    u8 held = 0;
+    for (const auto &[key, button] : KEY_MAP) {
+        if (IsKeyDown(key)) {
+            held |= button;
+        }
+    }
+
+    if (held != heldButtons && send(cmd_BUTTONS, held)) {
+        heldButtons = held;
+    }
+}
+
 void System::handle_events() {
     int key;
     do {
         key = GetKeyPressed();
         switch (key) {
         case KEY_SPACE:
-            cpu.clock();
+            send(cmd_STEP);
+            break;
+        case KEY_F:
+            send(cmd_FRAME);
             break;
         case KEY_R:
-            cpu.reset();
+            send(cmd_RESET);
             break;
         case KEY_I:
-            cpu.irq();
+            send(cmd_IRQ);
             break;
         case KEY_N:
-            cpu.nmi();
+            send(cmd_NMI);
+            break;
+        case KEY_F5:
+            send(cmd_SAVE_STATE);
+            break;
+        case KEY_F9:
+            send(cmd_LOAD_STATE);
+            break;
+        case KEY_F8:
+            trace.dump(TRACE_FILE);
+            break;
+        case KEY_P:
+            send(cmd_PLAY);
+            break;
+        case KEY_TAB:
+            send(cmd_FAST_FORWARD);
+            break;
+        case KEY_LEFT_BRACKET:
+            send(cmd_RUN_AHEAD_LESS);
+            break;
+        case KEY_RIGHT_BRACKET:
+            send(cmd_RUN_AHEAD_MORE);
+            break;
+        case KEY_T:
+            send(cmd_AUTO_RUN_AHEAD);
+            break;
+        case KEY_H:
+            showOverlay = !showOverlay;
             break;
         default:
             break;
         }
     } while (key != 0);
 }
+
+bool System::send(CommandType type, u32 value) {
+    // the emulation thread drains the queue at least once a frame, it only fills up if that
+    // thread is stuck, in which case dropping input is the least bad option
+    if (!commands.push({type, value})) {
+        TraceLog(LOG_WARNING, "Emulation thread is not keeping up, dropped input");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,75 @@
+#include "nes/trace.hpp"
+#include "nes/bus.hpp"
+
+#include <fmt/format.h>
+
+using namespace nes;
+
+//
+
+/// operand in 6502 assembler syntax
+static std::string format_operand(const TraceEntry &entry, const Instruction &ins) {
+    u8 lo   = entry.bytes[1];
+    u16 abs = (u16) (entry.bytes[2] << 8) | lo;
+
+    switch (ins.mode) {
+    case am_IMP:
+        // the shifts and rotates work on the accumulator in this mode
+        if (ins.op == op_ASL || ins.op == op_LSR || ins.op == op_ROL || ins.op == op_ROR) {
+            return "A";
+        }
+        return "";
+    case am_IMM: return fmt::format("#${:02X}", lo);
+    case am_ZP0: return fmt::format("${:02X}", lo);
+    case am_ZPX: return fmt::format("${:02X},X", lo);
+    case am_ZPY: return fmt::format("${:02X},Y", lo);
+    case am_ABS: return fmt::format("${:04X}", abs);
+    case am_ABX: return fmt::format("${:04X},X", abs);
+    case am_ABY: return fmt::format("${:04X},Y", abs);
+    case am_IND: return fmt::format("(${:04X})", abs);
+    case am_INX: return fmt::format("(${:02X},X)", lo);
+    case am_INY: return fmt::format("(${:02X}),Y", lo);
+    case am_REL: return fmt::format("${:04X}", (u16) (entry.PC + 2 + (int8_t) lo));
+    }
+    return "";
+}
+
+//
+
+TraceEntry nes::capture_trace(const Cpu &cpu) {
+    TraceEntry entry;
+    entry.PC = cpu.PC;
+    for (u32 i = 0; i < entry.bytes.size(); i++) {
+        entry.bytes[i] = cpu.bus->peek_u8((u16) (cpu.PC + i));
+    }
+    entry.A     = cpu.A;
+    entry.X     = cpu.X;
+    entry.Y     = cpu.Y;
+    entry.P     = cpu.P;
+    entry.SP    = cpu.SP;
+    entry.cycle = cpu.cyclesExecuted;
+    return entry;
+}
+
+std::string nes::format_trace(const TraceEntry &entry) {
+    const Instruction &ins = INSTRUCTION_LOOKUP[entry.bytes[0]];
+    u32 length             = 1 + OPERAND_LENGTH_LOOKUP[ins.mode];
+
+    std::string bytes;
+    for (u32 i = 0; i < length; i++) {
+        bytes += fmt::format(i == 0 ? "{:02X}" : " {:02X}", entry.bytes[i]);
+    }
+
+    std::string operand = format_operand(entry, ins);
+    std::string text    = INSTRUCTION_NAME_LOOKUP[ins.op];
+    if (!operand.empty()) {
+        text += " " + operand;
+    }
+
+    // like nestest.log, unofficial opcodes are marked with a * in front of the mnemonic
+    char mark = is_unofficial_opcode(entry.bytes[0]) ? '*' : ' ';
+
+    return fmt::format("{:04X}  {:<8} {}{:<32}A:{:02X} X:{:02X} Y:{:02X} P:{:02X} SP:{:02X} CYC:{}",
+                       entry.PC, bytes, mark, text, entry.A, entry.X, entry.Y, entry.P, entry.SP,
+                       entry.cycle);
+}
@@ -0,0 +1,184 @@
+#include "nes/trace_ring.hpp"
+
+#include "common/log.hpp"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <unistd.h>
+  #define NES_TRACE_POSIX 1
+#endif
+
+using namespace nes;
+
+//
+
+static constexpr std::array<char, 4> TRACE_DUMP_MAGIC = {'N', 'E', 'S', 'T'};
+
+static constexpr int CRASH_SIGNALS[] = {
+    SIGSEGV, SIGILL, SIGFPE, SIGABRT,
+#ifdef SIGBUS
+    SIGBUS,
+#endif
+};
+
+// the ring dump_on_crash() was last called for. a signal handler can only reach globals
+static const TraceRing *crashRing = nullptr;
+static char crashPath[1024];
+
+static size_t round_up_to_power_of_two(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result *= 2;
+    }
+    return result;
+}
+
+//
+
+TraceRing::TraceRing(size_t capacity)
+    : mask(round_up_to_power_of_two(std::max<size_t>(capacity, 1)) - 1) {
+    records = std::make_unique<TraceRecord[]>(mask + 1);
+}
+
+TraceRing::~TraceRing() {
+    if (crashRing == this) {
+        dump_on_crash(nullptr);
+    }
+}
+
+void TraceRing::snapshot(std::vector<TraceRecord> &out) const {
+    size_t capacity = mask + 1;
+
+    u64 end   = head.load(std::memory_order_acquire);
+    u64 begin = end - std::min<u64>(end, capacity);
+
+    out.resize(end - begin);
+    for (u64 i = begin; i < end; i++) {
+        out[i - begin] = records[i & mask];
+    }
+
+    // the writer may have lapped the oldest records while they were copied, including the one
+    // it is in the middle of writing
+    std::atomic_thread_fence(std::memory_order_acquire);
+    u64 after = head.load(std::memory_order_relaxed);
+    u64 valid = after + 1 > capacity ? after + 1 - capacity : 0;
+    if (valid > begin) {
+        out.erase(out.begin(), out.begin() + std::min<u64>(valid - begin, out.size()));
+    }
+}
+
+bool TraceRing::dump(const std::string &filepath) const {
+    std::vector<TraceRecord> held;
+    snapshot(held);
+
+    TraceDumpHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic   = TRACE_DUMP_MAGIC;
+    header.version = TRACE_DUMP_VERSION;
+    header.count   = held.size();
+
+    std::ofstream file(filepath, std::ios::binary);
+    file.write((const char *) &header, sizeof(header));
+    file.write((const char *) held.data(), held.size() * sizeof(TraceRecord));
+    if (!file) {
+        log_message(log_ERROR, "Failed to write trace dump: {}", filepath);
+        return false;
+    }
+    return true;
+}
+
+void TraceRing::dump_on_crash(const char *filepath) {
+    if (filepath == nullptr) {
+        crashRing = nullptr;
+        for (int signal : CRASH_SIGNALS) {
+            std::signal(signal, SIG_DFL);
+        }
+        return;
+    }
+
+    std::snprintf(crashPath, sizeof(crashPath), "%s", filepath);
+    crashRing = this;
+    for (int signal : CRASH_SIGNALS) {
+        std::signal(signal, on_crash);
+    }
+}
+
+void TraceRing::on_crash(int signal) {
+    // the crash most likely happened on the recording thread, so nothing is writing anymore.
+    // only async signal safe calls from here on where the platform has them
+    const TraceRing *ring = crashRing;
+    if (ring != nullptr) {
+        size_t capacity = ring->mask + 1;
+        u64 end         = ring->head.load(std::memory_order_relaxed);
+        u64 begin       = end - std::min<u64>(end, capacity);
+
+        TraceDumpHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.magic   = TRACE_DUMP_MAGIC;
+        header.version = TRACE_DUMP_VERSION;
+        header.count   = end - begin;
+
+        // oldest first, i.e. the part from the write position to the end of the buffer, then
+        // the start of the buffer
+        const TraceRecord *first = &ring->records[begin & ring->mask];
+        size_t firstCount        = std::min<u64>(end - begin, capacity - (begin & ring->mask));
+        const TraceRecord *rest  = &ring->records[0];
+        size_t restCount         = (end - begin) - firstCount;
+
+#ifdef NES_TRACE_POSIX
+        int fd = open(crashPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            (void) !write(fd, &header, sizeof(header));
+            (void) !write(fd, first, firstCount * sizeof(TraceRecord));
+            (void) !write(fd, rest, restCount * sizeof(TraceRecord));
+            close(fd);
+        }
+#else
+        if (std::FILE *file = std::fopen(crashPath, "wb")) {
+            std::fwrite(&header, sizeof(header), 1, file);
+            std::fwrite(first, sizeof(TraceRecord), firstCount, file);
+            std::fwrite(rest, sizeof(TraceRecord), restCount, file);
+            std::fclose(file);
+        }
+#endif
+    }
+
+    // let the default action (core dump, debugger) happen
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+//
+
+bool nes::read_trace_dump(const std::string &filepath, std::vector<TraceRecord> &records) {
+    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+    u64 fileSize = file ? (u64) file.tellg() : 0;
+    file.seekg(0);
+
+    TraceDumpHeader header;
+    file.read((char *) &header, sizeof(header));
+    if (!file || header.magic != TRACE_DUMP_MAGIC || header.version != TRACE_DUMP_VERSION) {
+        log_message(log_ERROR, "Not a trace dump of this version: {}", filepath);
+        return false;
+    }
+
+    // the count comes from the file, check it before allocating for it
+    if (header.count > (fileSize - sizeof(header)) / sizeof(TraceRecord)) {
+        log_message(log_ERROR, "Trace dump is truncated: {}", filepath);
+        return false;
+    }
+
+    records.resize(header.count);
+    file.read((char *) records.data(), records.size() * sizeof(TraceRecord));
+    if (!file) {
+        log_message(log_ERROR, "Trace dump is truncated: {}", filepath);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+#include "nes/core_batch.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <vector>
+
+#include "common/crc32.hpp"
+
+using namespace nes;
+
+//
+
+struct BenchResult {
+    double seconds;
+    u32 crc; // of the final observations, to check the thread counts agree
+};
+
+/// reward for the tests, the sum of the zero page
+static float zero_page_sum(void *, const Core &core, u32) {
+    float sum = 0.0f;
+    for (u32 i = 0; i < 256; i++) {
+        sum += core.mem.data()[i];
+    }
+    return sum;
+}
+
+static BenchResult run(const char *romFile, u32 cores, u32 threads, u32 steps) {
+    CoreBatch batch(cores, threads);
+    if (!batch.load_rom(romFile)) {
+        std::exit(1);
+    }
+    batch.set_reward_function(zero_page_sum, nullptr);
+
+    std::vector<u8> actions(cores);
+    std::vector<u8> frames(cores * CoreBatch::FRAME_SIZE);
+    std::vector<u8> ram(cores * CoreBatch::RAM_SIZE);
+    std::vector<float> rewards(cores);
+    BatchObservations observations = {frames.data(), ram.data(), rewards.data()};
+
+    u32 seed   = 0x12345678;
+    auto start = std::chrono::steady_clock::now();
+    for (u32 s = 0; s < steps; s++) {
+        // deterministic random buttons, so every thread count sees the same inputs
+        for (auto &action : actions) {
+            seed   = seed * 1664525 + 1013904223;
+            action = (u8) (seed >> 24);
+        }
+        batch.step(actions.data(), observations);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    u32 crc = crc32(frames.data(), frames.size());
+    crc     = crc32(ram.data(), ram.size(), crc);
+    crc     = crc32((const u8 *) rewards.data(), rewards.size() * sizeof(float), crc);
+
+    return {std::chrono::duration<double>(end - start).count(), crc};
+}
+
+int main(int argc, char **argv) {
+    const char *romFile = argc > 1 ? argv[1] : "assets/test/nestest.nes";
+    u32 cores           = argc > 2 ? (u32) std::strtoul(argv[2], nullptr, 10) : 64;
+    u32 steps           = argc > 3 ? (u32) std::strtoul(argv[3], nullptr, 10) : 120;
+    u32 threads         = argc > 4 ? (u32) std::strtoul(argv[4], nullptr, 10)
+                                   : std::thread::hardware_concurrency();
+    threads             = threads > 0 ? threads : 1;
+
+    auto single   = run(romFile, cores, 1, steps);
+    auto parallel = run(romFile, cores, threads, steps);
+
+    auto report = [&](u32 t, const BenchResult &r) {
+        fmt::print("{:>3} threads : {:>9.0f} frames/s  ({:.3f} s, observations CRC32 {:08X})\n", t,
+                   (double) cores * steps / r.seconds, r.seconds, r.crc);
+    };
+
+    fmt::print("{} cores x {} steps\n", cores, steps);
+    report(1, single);
+    report(threads, parallel);
+    fmt::print("speedup     : {:.2f}x\n", single.seconds / parallel.seconds);
+
+    if (single.crc != parallel.crc) {
+        fmt::print(stderr, "ERROR: observations depend on the thread count\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "nes/core.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fmt/core.h>
+
+using namespace nes;
+
+//
+
+struct BenchResult {
+    double seconds;
+    u64 cycles;
+    u16 PC;
+};
+
+/// run the given number of instructions from reset on a fresh core through the given clock path
+template <typename ClockFn>
+static BenchResult run(const char *romFile, u64 instructions, ClockFn clock) {
+    Core core;
+    if (!core.load_rom(romFile)) {
+        std::exit(1);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (u64 i = 0; i < instructions; i++) {
+        clock(core.cpu);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return {std::chrono::duration<double>(end - start).count(), core.cpu.cyclesExecuted,
+            core.cpu.PC};
+}
+
+int main(int argc, char **argv) {
+    const char *romFile = argc > 1 ? argv[1] : "assets/test/nestest.nes";
+    u64 instructions    = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 50'000'000;
+
+    auto reference = run(romFile, instructions, [](Cpu &cpu) { cpu.clock_reference(); });
+    auto dispatch  = run(romFile, instructions, [](Cpu &cpu) { cpu.clock(); });
+
+    auto report = [&](const char *name, const BenchResult &r) {
+        fmt::print("{:<10} : {:>8.2f} M instructions/s  ({:.3f} s, {} cycles, PC = 0x{:04x})\n",
+                   name, instructions / r.seconds / 1e6, r.seconds, r.cycles, r.PC);
+    };
+
+    report("reference", reference);
+    report("dispatch", dispatch);
+    fmt::print("speedup    : {:.2f}x\n", reference.seconds / dispatch.seconds);
+
+    if (reference.cycles != dispatch.cycles || reference.PC != dispatch.PC) {
+        fmt::print(stderr, "ERROR: dispatch and reference paths diverged\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "nes/core.hpp"
+#include "nes/ppu_composite.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/core.h>
+#include <vector>
+
+using namespace nes;
+
+//
+
+static constexpr u32 WIDTH  = Ppu::SCREEN_WIDTH;
+static constexpr u32 HEIGHT = Ppu::SCREEN_HEIGHT;
+
+struct BenchResult {
+    double seconds;
+    u32 hits;
+    std::vector<u8> output;
+};
+
+/// composite every captured line the given number of times
+static BenchResult run(CompositeKernel kernel, const std::vector<u8> &bg, const std::vector<u8> &sp,
+                       const u8 *palette, u32 passes) {
+    BenchResult r = {0.0, 0, std::vector<u8>(WIDTH * HEIGHT)};
+
+    auto start = std::chrono::steady_clock::now();
+    for (u32 pass = 0; pass < passes; pass++) {
+        for (u32 line = 0; line < HEIGHT; line++) {
+            u8 clip = (line & 1) ? 0xFF : 0x00; // exercise both left clipping settings
+            r.hits += kernel(&bg[line * WIDTH], &sp[line * WIDTH], palette, clip, clip, 0x3F,
+                             &r.output[line * WIDTH]);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    r.seconds = std::chrono::duration<double>(end - start).count();
+    return r;
+}
+
+int main(int argc, char **argv) {
+    const char *romFile = argc > 1 ? argv[1] : "assets/test/nestest.nes";
+    u32 passes          = argc > 2 ? (u32) std::strtoul(argv[2], nullptr, 10) : 20'000;
+
+    Core core;
+    if (!core.load_rom(romFile)) {
+        return 1;
+    }
+    for (u32 i = 0; i < 60; i++) {
+        core.run_frame();
+    }
+
+    // deterministic sprites scattered over the screen
+    u32 seed = 0x12345678;
+    for (u32 i = 1; i < 64; i++) {
+        seed = seed * 1664525 + 1013904223;
+        core.ppu.oam[i * 4 + 0] = (u8) (seed >> 24) % 232;
+        core.ppu.oam[i * 4 + 1] = (u8) (seed >> 16);
+        core.ppu.oam[i * 4 + 2] = (u8) (seed >> 8) & 0x23;
+        core.ppu.oam[i * 4 + 3] = (u8) seed;
+    }
+    core.ppu.write_register(0x2001, 0x1E);
+
+    std::vector<u8> bg(WIDTH * HEIGHT), sp(WIDTH * HEIGHT);
+    auto render_line = [&](u32 line) {
+        // point v at the tile row of the first nametable through PPUADDR, which can only set
+        // the low two bits of fine y, so each tile row is sampled 4 times
+        u16 address = 0x2000 | ((line & 0x03) << 12) | ((line / 8) << 5);
+        core.ppu.write_register(0x2006, address >> 8);
+        core.ppu.write_register(0x2006, address & 0xFF);
+        core.ppu.render_layers(line, &bg[line * WIDTH], &sp[line * WIDTH]);
+    };
+    auto capture = [&] {
+        for (u32 line = 0; line < HEIGHT; line++) {
+            render_line(line);
+        }
+    };
+
+    // put sprite 0 on the first opaque background pixel, with a tile that overlaps it
+    capture();
+    for (u32 i = 8 * WIDTH; i < bg.size(); i++) {
+        if ((bg[i] & 0x03) == 0 || i % WIDTH < 8 || i % WIDTH > 240) {
+            continue;
+        }
+        u32 line = i / WIDTH, x = i % WIDTH;
+        core.ppu.oam[0] = (u8) (line - 1);
+        core.ppu.oam[2] = 0;
+        core.ppu.oam[3] = (u8) x;
+        for (u32 tile = 0; tile < 256; tile++) {
+            core.ppu.oam[1] = (u8) tile;
+            render_line(line);
+            if ((sp[i] & 0x83) > 0x80) {
+                break;
+            }
+        }
+        break;
+    }
+    capture();
+
+    u8 palette[32];
+    for (u32 i = 0; i < 32; i++) {
+        palette[i] = (u8) (i * 7 + 3) & 0x3F;
+    }
+
+    auto scalar = run(get_composite_kernel(cl_SCALAR), bg, sp, palette, passes);
+    double ns   = 1e9 / ((double) passes * HEIGHT);
+    fmt::print("{:<7} : {:>7.1f} ns/line  ({} sprite 0 hits)\n", "scalar", scalar.seconds * ns,
+               scalar.hits);
+
+    bool ok = true;
+    for (auto [level, name] : {std::pair{cl_SSE2, "sse2"}, std::pair{cl_AVX2, "avx2"}}) {
+        auto kernel = get_composite_kernel(level);
+        if (kernel == nullptr) {
+            fmt::print("{:<7} : unavailable\n", name);
+            continue;
+        }
+
+        auto r = run(kernel, bg, sp, palette, passes);
+        fmt::print("{:<7} : {:>7.1f} ns/line  ({} sprite 0 hits)  speedup {:.2f}x\n", name,
+                   r.seconds * ns, r.hits, scalar.seconds / r.seconds);
+
+        if (r.hits != scalar.hits || r.output != scalar.output) {
+            fmt::print(stderr, "ERROR: {} kernel differs from the scalar kernel\n", name);
+            ok = false;
+        }
+    }
+
+    return ok ? 0 : 1;
+}
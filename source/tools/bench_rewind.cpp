@@ -0,0 +1,82 @@
+#include "nes/core.hpp"
+#include "nes/rewind.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/core.h>
+#include <vector>
+
+using namespace nes;
+
+//
+
+static constexpr size_t RING_SIZE = 16 * 1024 * 1024;
+
+int main(int argc, char **argv) {
+    const char *romFile = argc > 1 ? argv[1] : "assets/test/nestest.nes";
+    u32 frames          = argc > 2 ? (u32) std::strtoul(argv[2], nullptr, 10) : 3600;
+    u32 interval        = argc > 3 ? (u32) std::strtoul(argv[3], nullptr, 10)
+                                   : Rewind::DEFAULT_KEYFRAME_INTERVAL;
+
+    Core core;
+    if (!core.load_rom(romFile)) {
+        return 1;
+    }
+
+    Rewind rewind(core, RING_SIZE, interval);
+
+    // raw states of every frame, to check what comes back out of the ring
+    size_t stateSize = core.get_save_state_size();
+    std::vector<u8> expected((size_t) frames * stateSize);
+    std::vector<u8> actual(stateSize);
+
+    double encodeSeconds = 0.0;
+    for (u32 i = 0; i < frames; i++) {
+        core.run_frame();
+        core.save_state(&expected[(size_t) i * stateSize], stateSize);
+
+        auto start = std::chrono::steady_clock::now();
+        rewind.push();
+        auto end = std::chrono::steady_clock::now();
+        encodeSeconds += std::chrono::duration<double>(end - start).count();
+    }
+
+    u64 stored = rewind.get_frame_count();
+    u64 pushed = rewind.keyframes + rewind.deltas;
+
+    fmt::print("state size : {} bytes\n", stateSize);
+    fmt::print("keyframes  : {:>6} x {:>8.1f} bytes\n", rewind.keyframes,
+               rewind.keyframes ? (double) rewind.keyframeBytes / rewind.keyframes : 0.0);
+    fmt::print("deltas     : {:>6} x {:>8.1f} bytes\n", rewind.deltas,
+               rewind.deltas ? (double) rewind.deltaBytes / rewind.deltas : 0.0);
+    fmt::print("per frame  : {:.1f} bytes ({:.2f}% of a full state)\n",
+               (double) (rewind.keyframeBytes + rewind.deltaBytes) / pushed,
+               100.0 * (rewind.keyframeBytes + rewind.deltaBytes) / ((double) pushed * stateSize));
+    fmt::print("held       : {} frames in {} KiB ({:.1f} s at 60 fps)\n", stored,
+               rewind.get_used_bytes() / 1024, stored / 60.0);
+    fmt::print("encode     : {:.2f} us/frame (including save_state)\n",
+               encodeSeconds / pushed * 1e6);
+
+    double decodeSeconds = 0.0;
+    u64 popped           = 0;
+    for (u64 i = pushed; i-- > pushed - stored;) {
+        auto start = std::chrono::steady_clock::now();
+        bool ok    = rewind.pop();
+        auto end   = std::chrono::steady_clock::now();
+        decodeSeconds += std::chrono::duration<double>(end - start).count();
+        popped++;
+
+        core.save_state(actual.data(), stateSize);
+        if (!ok || std::memcmp(actual.data(), &expected[i * stateSize], stateSize) != 0) {
+            fmt::print(stderr, "ERROR: frame {} did not rewind to the state it was pushed with\n",
+                       i);
+            return 1;
+        }
+    }
+
+    fmt::print("decode     : {:.2f} us/frame (including load_state)\n",
+               decodeSeconds / popped * 1e6);
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "nes/core.hpp"
+#include "nes/profiler.hpp"
+#include "nes/run_ahead.hpp"
+#include "nes/trace_ring.hpp"
+#include "common/log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/core.h>
+#include <memory>
+#include <vector>
+
+using namespace nes;
+
+//
+
+static void print_usage(const char *program) {
+    fmt::print(stderr,
+               "usage: {} <rom> [--frames N | --cycles N] [--run-ahead N] [--romdb FILE]\n"
+               "       [--warnings] [--trace FILE] [--profile PREFIX] [--sample-rate HZ]\n",
+               program);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const char *romFile = argv[1];
+
+    u64 frames = 600; // ten seconds of NTSC emulation by default
+    u64 cycles = 0;
+
+    u32 runAheadFrames = 0;
+    bool runAhead      = false;
+
+    RomDatabase romDatabase;
+
+    const char *traceFile     = nullptr;
+    const char *profilePrefix = nullptr;
+
+    u32 sampleRate = 0;
+
+    for (int i = 2; i < argc; i++) {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::strtoull(argv[++i], nullptr, 10);
+            cycles = 0;
+        } else if (std::strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            cycles = std::strtoull(argv[++i], nullptr, 10);
+            frames = 0;
+        } else if (std::strcmp(argv[i], "--run-ahead") == 0 && i + 1 < argc) {
+            runAheadFrames = (u32) std::strtoul(argv[++i], nullptr, 10);
+            runAhead       = true;
+        } else if (std::strcmp(argv[i], "--romdb") == 0 && i + 1 < argc) {
+            if (!romDatabase.load(argv[++i])) {
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--sample-rate") == 0 && i + 1 < argc) {
+            sampleRate = (u32) std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profilePrefix = argv[++i];
+        } else if (std::strcmp(argv[i], "--warnings") == 0) {
+            set_hot_path_warnings(true);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Core core;
+    core.romDatabase = &romDatabase;
+    if (!core.load_rom(romFile)) {
+        return 1;
+    }
+    fmt::print("rom             : mapper {}, CRC32 {:08X}\n", core.rom->get_mapper_id(),
+               core.rom->get_crc32());
+
+    // the last instructions go to the trace file at the end of the run, or when it crashes
+    TraceRing trace;
+    if (traceFile != nullptr) {
+        core.cpu.trace = &trace;
+        trace.dump_on_crash(traceFile);
+    }
+
+    // counts are written out as PREFIX.opcodes.csv, .modes.csv, .pcs.csv and .folded at the end
+    std::unique_ptr<Profiler> profiler;
+    if (profilePrefix != nullptr) {
+        profiler = std::make_unique<Profiler>(core.bus, core.rom->get_prg_data(),
+                                              core.rom->get_prg_size());
+        core.cpu.profiler = profiler.get();
+    }
+
+    RunAhead ahead(core);
+    ahead.set_frames(runAheadFrames);
+
+    // samples are read every frame and thrown away, the way an audio device would take them
+    core.apu.set_sample_rate(sampleRate);
+    std::vector<int16_t> samples(sampleRate / 10);
+    u64 samplesRead = 0;
+    auto drain_samples = [&]() {
+        while (size_t n = core.apu.read_samples(samples.data(), samples.size())) {
+            samplesRead += n;
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    u64 executed = 0;
+    if (cycles != 0) {
+        executed = core.run_cycles(cycles);
+    } else if (runAhead) {
+        // only the real timeline counts towards the cycles executed
+        for (u64 f = 0; f < frames; f++) {
+            u64 before = core.cpu.cyclesExecuted;
+            ahead.run_frame();
+            executed += core.cpu.cyclesExecuted - before;
+            drain_samples();
+        }
+    } else {
+        for (u64 f = 0; f < frames; f++) {
+            executed += core.run_frame();
+            drain_samples();
+        }
+    }
+
+    auto end     = std::chrono::steady_clock::now();
+    auto seconds = std::chrono::duration<double>(end - start).count();
+
+    double cyclesPerSecond = seconds > 0 ? executed / seconds : 0.0;
+    double realtime        = cyclesPerSecond / CPU_CLOCK_RATE_HZ;
+
+    fmt::print("cycles executed : {}\n", executed);
+    fmt::print("wall time       : {:.3f} s\n", seconds);
+    fmt::print("cycles / second : {:.0f}\n", cyclesPerSecond);
+    fmt::print("realtime        : {:.1f}%\n", realtime * 100.0);
+
+    if (sampleRate != 0) {
+        drain_samples();
+        fmt::print("audio           : {} samples ({:.3f} s), {} dropped\n", samplesRead,
+                   (double) samplesRead / sampleRate, core.apu.droppedSamples);
+    }
+
+    if (runAhead && cycles == 0) {
+        fmt::print(
+            "run-ahead       : {} frames, {:.1f} us real frame + {:.1f} us per frame ahead\n",
+            ahead.get_frames(), ahead.get_real_frame_cost() * 1e6,
+            ahead.get_ahead_frame_cost() * 1e6);
+    }
+
+    const auto &cache = core.blockCache;
+    u64 lookups       = cache.hits + cache.misses;
+    fmt::print("block cache     : {} hits, {} misses ({:.2f}% hit rate), {} invalidations\n",
+               cache.hits, cache.misses, lookups ? 100.0 * cache.hits / lookups : 0.0,
+               cache.invalidations);
+
+    if (profilePrefix != nullptr) {
+        u64 instructions = 0;
+        for (const auto &counter : profiler->get_opcodes()) {
+            instructions += counter.executions;
+        }
+        fmt::print("profile         : {} instructions in {}.*\n", instructions, profilePrefix);
+
+        std::string prefix = profilePrefix;
+        bool ok = profiler->write_csv(prefix + ".opcodes.csv", prof_OPCODES) &&
+                  profiler->write_csv(prefix + ".modes.csv", prof_MODES) &&
+                  profiler->write_csv(prefix + ".pcs.csv", prof_PCS) &&
+                  profiler->write_folded(prefix + ".folded");
+        if (!ok) {
+            return 1;
+        }
+    }
+
+    if (traceFile != nullptr) {
+        fmt::print("trace           : {} instructions, last {} in {}\n", trace.get_count(),
+                   std::min<u64>(trace.get_count(), trace.get_capacity()), traceFile);
+        return trace.dump(traceFile) ? 0 : 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "nes/core.hpp"
+#include "nes/movie.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/core.h>
+
+using namespace nes;
+
+//
+
+static void print_usage() {
+    fmt::print("usage: nes_movie record <rom> <movie> [frames] [seed]\n"
+               "       nes_movie replay <rom> <movie>\n");
+}
+
+/// xorshift32, movies recorded with the same seed are identical
+static u32 next_random(u32 &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static int record(Core &core, const char *movieFile, u32 frames, u32 seed) {
+    Movie movie;
+    MovieRecorder recorder(core, movie);
+
+    // a scripted player: hold a random combination of buttons for a random number of frames,
+    // the way a person would rather than changing every frame
+    u32 state   = seed != 0 ? seed : 1;
+    u8 buttons  = 0;
+    u32 holdFor = 0;
+    for (u32 i = 0; i < frames; i++) {
+        if (holdFor == 0) {
+            buttons = (u8) next_random(state);
+            holdFor = 1 + next_random(state) % 30;
+        }
+        holdFor--;
+        recorder.run_frame(buttons, 0);
+    }
+
+    if (!movie.save(movieFile)) {
+        return 1;
+    }
+    fmt::print("recorded {} frames, {} checkpoints\n", movie.input.size(),
+               movie.checkpoints.size());
+    return 0;
+}
+
+static int replay(Core &core, const char *movieFile) {
+    Movie movie;
+    if (!movie.load(movieFile, core)) {
+        return 1;
+    }
+
+    auto start          = std::chrono::steady_clock::now();
+    ReplayResult result = replay_movie(core, movie);
+    auto end            = std::chrono::steady_clock::now();
+    double seconds      = std::chrono::duration<double>(end - start).count();
+
+    fmt::print("replayed {} frames in {:.3f} s ({:.0f} fps, {:.1f}x real time)\n", result.frames,
+               seconds, result.frames / seconds, result.frames / seconds / 60.0988);
+    if (!result.ok && result.mismatchFrame == 0) {
+        return 1; // never got to compare, replay_movie() logged why
+    }
+    if (!result.ok) {
+        fmt::print("MISMATCH at the checkpoint after frame {} ({} checkpoints matched)\n",
+                   result.mismatchFrame, result.checkpoints);
+        return 1;
+    }
+    fmt::print("ok, {} checkpoints matched\n", result.checkpoints);
+    return 0;
+}
+
+//
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        print_usage();
+        return 2;
+    }
+
+    Core core;
+    if (!core.load_rom(argv[2])) {
+        return 1;
+    }
+
+    if (std::strcmp(argv[1], "record") == 0) {
+        u32 frames = argc > 4 ? (u32) std::strtoul(argv[4], nullptr, 10) : 36000;
+        u32 seed   = argc > 5 ? (u32) std::strtoul(argv[5], nullptr, 10) : 1;
+        return record(core, argv[3], frames, seed);
+    }
+    if (std::strcmp(argv[1], "replay") == 0) {
+        return replay(core, argv[3]);
+    }
+
+    print_usage();
+    return 2;
+}
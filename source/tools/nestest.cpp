@@ -0,0 +1,208 @@
+#include "nes/core.hpp"
+#include "nes/trace.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fmt/core.h>
+#include <fstream>
+#include <string>
+
+using namespace nes;
+
+//
+
+/// nestest's automation mode entry point, runs every test without needing a PPU
+static constexpr u16 AUTOMATION_START = 0xC000;
+
+/// what the cpu looks like at AUTOMATION_START in nestest.log, i.e. after the 7 cycle reset
+/// sequence
+static constexpr u8 START_P      = 0x24;
+static constexpr u64 START_CYCLE = 7;
+
+/// instructions nestest runs in automation mode before returning, the length of nestest.log
+static constexpr u64 AUTOMATION_LENGTH = 8991;
+
+/// lines of our own trace shown before a divergence
+static constexpr size_t CONTEXT_LINES = 8;
+
+enum CpuPath {
+    path_BLOCK,     // Core::step, through the block cache like a normal run
+    path_DISPATCH,  // Cpu::clock, the specialized dispatch table
+    path_REFERENCE, // Cpu::clock_reference
+};
+
+static void print_usage() {
+    fmt::print(stderr, "usage: nes_nestest <nestest.nes> [nestest.log]\n"
+                       "       [--path block|dispatch|reference] [--count N]\n"
+                       "without a log the trace is printed instead of compared\n");
+}
+
+/// nestest leaves the number of the first failed official / unofficial test in $02 / $03.
+/// returns the exit code, non-zero if either is set
+static int check_result(const Core &core, u64 lines) {
+    u8 official   = core.mem.data()[0x02];
+    u8 unofficial = core.mem.data()[0x03];
+    fmt::print("{} lines, result codes $02 = {:02X}, $03 = {:02X}\n", lines, official,
+               unofficial);
+    return official == 0 && unofficial == 0 ? 0 : 1;
+}
+
+/// hex value following key in the line, or -1 if the key isn't there
+static long parse_field(const std::string &line, const char *key, int base = 16) {
+    size_t at = line.find(key);
+    if (at == std::string::npos) {
+        return -1;
+    }
+    return std::strtol(line.c_str() + at + std::strlen(key), nullptr, base);
+}
+
+/// compare our entry with a golden line on PC, instruction bytes, registers and cycles. the
+/// disassembly and the PPU column are left out, their formatting differs between emulators.
+/// returns the first field that differs, or nullptr if they match
+static const char *compare(const TraceEntry &entry, const std::string &golden) {
+    if (golden.size() < 16 || std::strtol(golden.substr(0, 4).c_str(), nullptr, 16) != entry.PC) {
+        return "PC";
+    }
+
+    u32 length = 1 + OPERAND_LENGTH_LOOKUP[INSTRUCTION_LOOKUP[entry.bytes[0]].mode];
+    for (u32 i = 0; i < 3; i++) {
+        std::string hex = golden.substr(6 + i * 3, 2);
+        if (hex == "  ") {
+            if (i < length) {
+                return "instruction length";
+            }
+            break;
+        }
+        if (i >= length) {
+            return "instruction length";
+        }
+        if (std::strtol(hex.c_str(), nullptr, 16) != entry.bytes[i]) {
+            return "instruction bytes";
+        }
+    }
+
+    if (parse_field(golden, " A:") != entry.A) {
+        return "A";
+    }
+    if (parse_field(golden, " X:") != entry.X) {
+        return "X";
+    }
+    if (parse_field(golden, " Y:") != entry.Y) {
+        return "Y";
+    }
+    if (parse_field(golden, " P:") != entry.P) {
+        return "P";
+    }
+    if (parse_field(golden, " SP:") != entry.SP) {
+        return "SP";
+    }
+    if (parse_field(golden, "CYC:", 10) != (long) entry.cycle) {
+        return "CYC";
+    }
+    return nullptr;
+}
+
+static void execute(Core &core, CpuPath path) {
+    switch (path) {
+    case path_BLOCK:     core.step(); break;
+    case path_DISPATCH:  core.cpu.clock(); break;
+    case path_REFERENCE: core.cpu.clock_reference(); break;
+    }
+}
+
+//
+
+int main(int argc, char **argv) {
+    const char *romFile = nullptr;
+    const char *logFile = nullptr;
+    CpuPath path        = path_BLOCK;
+    u64 count           = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--path") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+            if (std::strcmp(name, "block") == 0) {
+                path = path_BLOCK;
+            } else if (std::strcmp(name, "dispatch") == 0) {
+                path = path_DISPATCH;
+            } else if (std::strcmp(name, "reference") == 0) {
+                path = path_REFERENCE;
+            } else {
+                print_usage();
+                return 2;
+            }
+        } else if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = std::strtoull(argv[++i], nullptr, 10);
+        } else if (romFile == nullptr) {
+            romFile = argv[i];
+        } else if (logFile == nullptr) {
+            logFile = argv[i];
+        } else {
+            print_usage();
+            return 2;
+        }
+    }
+    if (romFile == nullptr) {
+        print_usage();
+        return 2;
+    }
+
+    Core core;
+    if (!core.load_rom(romFile)) {
+        return 1;
+    }
+
+    core.cpu.PC             = AUTOMATION_START;
+    core.cpu.P              = START_P;
+    core.cpu.cyclesExecuted = START_CYCLE;
+
+    // no log, print the trace and go by the result codes alone
+    if (logFile == nullptr) {
+        u64 lines = count != 0 ? count : AUTOMATION_LENGTH;
+        for (u64 i = 0; i < lines; i++) {
+            fmt::print("{}\n", format_trace(capture_trace(core.cpu)));
+            execute(core, path);
+        }
+        return check_result(core, lines);
+    }
+
+    std::ifstream golden(logFile);
+    if (!golden) {
+        fmt::print(stderr, "Failed to open golden log: {}\n", logFile);
+        return 1;
+    }
+
+    std::deque<std::string> context;
+    std::string line;
+    u64 lineNumber = 0;
+    while (std::getline(golden, line) && (count == 0 || lineNumber < count)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        lineNumber++;
+
+        TraceEntry entry  = capture_trace(core.cpu);
+        std::string ours  = format_trace(entry);
+        const char *field = compare(entry, line);
+        if (field != nullptr) {
+            fmt::print("divergence at line {} ({} differs)\n", lineNumber, field);
+            for (const auto &previous : context) {
+                fmt::print("          {}\n", previous);
+            }
+            fmt::print("expected: {}\n", line);
+            fmt::print("actual  : {}\n", ours);
+            return 1;
+        }
+
+        context.push_back(std::move(ours));
+        if (context.size() > CONTEXT_LINES) {
+            context.pop_front();
+        }
+
+        execute(core, path);
+    }
+
+    fmt::print("all lines match\n");
+    return check_result(core, lineNumber);
+}
@@ -0,0 +1,34 @@
+#include "nes/trace.hpp"
+#include "nes/trace_ring.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fmt/core.h>
+#include <vector>
+
+using namespace nes;
+
+//
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fmt::print(stderr, "usage: nes_trace_decode <dump> [--last N]\n");
+        return 2;
+    }
+
+    u64 last = 0;
+    if (argc > 3 && std::strcmp(argv[2], "--last") == 0) {
+        last = std::strtoull(argv[3], nullptr, 10);
+    }
+
+    std::vector<TraceRecord> records;
+    if (!read_trace_dump(argv[1], records)) {
+        return 1;
+    }
+
+    size_t first = last != 0 && last < records.size() ? records.size() - last : 0;
+    for (size_t i = first; i < records.size(); i++) {
+        fmt::print("{}\n", format_trace(to_trace_entry(records[i])));
+    }
+    return 0;
+}